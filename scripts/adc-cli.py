@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Console of the ADC sampler over the serial port (USART1, 115200 8N1).
+
+  usage: adc-cli.py [-p /dev/ttyACM0] [command ...]
+
+  adc-cli.py status
+  adc-cli.py set block=2000 smp=144 period=500
+  adc-cli.py stop
+  adc-cli.py                  (interactive)
+
+Every command is answered by one line: "ok key=value ..." or "err reason".
+The receiver is not clocked while the MCU is in STOP: a wake up byte is sent
+first and the command follows once the clocks are back.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+WAKE_DELAY_S = 0.05
+REPLY_TIMEOUT_S = 3.0
+
+
+def command(port, line):
+    port.write(b'\n')
+    time.sleep(WAKE_DELAY_S)
+    port.reset_input_buffer()
+    port.write(line.encode('ascii') + b'\n')
+
+    deadline = time.monotonic() + REPLY_TIMEOUT_S
+    while time.monotonic() < deadline:
+        reply = port.readline().decode('ascii', errors='replace').strip()
+        if reply.startswith('ok') or reply.startswith('err'):
+            return reply
+    return 'err no reply'
+
+
+def show(reply):
+    words = reply.split()
+    if words[0] == 'ok' and all('=' in word for word in words[1:]) and len(words) > 1:
+        for word in words[1:]:
+            key, value = word.split('=', 1)
+            print('%-12s %s' % (key, value))
+    else:
+        print(reply)
+    return words[0] == 'ok'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='ADC sampler console')
+    parser.add_argument('-p', '--port', default='/dev/ttyACM0')
+    parser.add_argument('-b', '--baud', type=int, default=115200)
+    parser.add_argument('command', nargs='*')
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+        if args.command:
+            return 0 if show(command(port, ' '.join(args.command))) else 1
+
+        while True:
+            try:
+                line = input('adc> ').strip()
+            except EOFError:
+                return 0
+            if line in ('quit', 'exit'):
+                return 0
+            if line:
+                show(command(port, line))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Read the measurement log from a dump of the log sectors (see make log-dump)
+and print the records in time order as CSV.
+
+  usage: flashlog-read.py <dump.bin> [sector size in bytes, default 131072]
+"""
+
+import struct
+import sys
+
+MAGIC = 0x474F4C46
+RECORD = struct.Struct('<IIIHBB')
+HEADER = struct.Struct('<IIII')
+FLAG_BOOT = 0x01
+FLAG_GAP = 0x02
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def read_sector(data):
+    magic, sequence, erase_count, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        return None
+    records = []
+    corrupted = 0
+    for offset in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        slot = data[offset:offset + RECORD.size]
+        if slot == b'\xff' * RECORD.size:
+            break
+        if crc8(slot[:-1]) != slot[-1]:
+            corrupted += 1
+            continue
+        records.append(RECORD.unpack(slot))
+    return sequence, erase_count, records, corrupted
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+
+    dump = open(sys.argv[1], 'rb').read()
+    sector_size = int(sys.argv[2]) if len(sys.argv) > 2 else 131072
+
+    sectors = []
+    for base in range(0, len(dump), sector_size):
+        sector = read_sector(dump[base:base + sector_size])
+        if sector is not None:
+            sectors.append(sector)
+
+    # oldest sector first
+    sectors.sort(key=lambda s: s[0])
+    for sequence, erase_count, records, corrupted in sectors:
+        print('# sector %d: %d records, %d corrupted, %d erases' % (sequence, len(records), corrupted, erase_count), file=sys.stderr)
+
+    print('sequence,timestamp_ms,digital_value,length,mean,boot,gap')
+    for _, _, records, _ in sectors:
+        for sequence, timestamp_ms, digital_value, length, flags, _ in records:
+            mean = digital_value / length if length else 0
+            print('%d,%d,%d,%d,%.2f,%d,%d' % (sequence, timestamp_ms, digital_value, length, mean,
+                                               1 if flags & FLAG_BOOT else 0, 1 if flags & FLAG_GAP else 0))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Convert the event trace of the firmware (trace.c) into the Chrome trace event
+format (chrome://tracing, https://ui.perfetto.dev).
+
+  usage: trace-convert.py [--swo] [--hz HCLK] <dump.bin> > trace.json
+
+The input is either a RAM dump that contains the recorder (see make trace-dump,
+the recorder is found by its magic) or, with --swo, a raw SWO capture of the
+"trace" console command (ITM stimulus port 1).
+
+The cycle counter stops in the sleep modes: the time spent sleeping is taken from
+the sleep events. --hz is the core clock assumed before the first clock event of
+the window when the ring has wrapped (default 96MHz).
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x45435254
+ITM_PORT = 1
+OBJECTS = 16
+NAME_LEN = 12
+HEADER = struct.Struct('<IIIIII')
+OBJECT = struct.Struct('<I%ds' % NAME_LEN)
+EVENT = struct.Struct('<IBBHI')
+
+(ISR_ENTER, ISR_EXIT, TASK_IN, TASK_OUT, QUEUE_SEND, QUEUE_SEND_FAILED, QUEUE_RECEIVE,
+ QUEUE_RECEIVE_FAILED, CLOCK, SLEEP, MARK, FAULT) = range(12)
+
+QUEUE_EVENTS = {
+    QUEUE_SEND: 'send',
+    QUEUE_SEND_FAILED: 'send failed',
+    QUEUE_RECEIVE: 'receive',
+    QUEUE_RECEIVE_FAILED: 'receive failed',
+}
+IRQS = {3: 'RTC_WKUP', 28: 'TIM2', 37: 'USART1', 40: 'EXTI15_10', 56: 'DMA2_Stream0'}
+POWER_SLEEP, POWER_STOP = 1, 2
+MARKS = ['burst start', 'burst end', 'block dropped', 'block lost', 'config', 'display start', 'display end',
+         'boot failure', 'dma timeout', 'clock rejected']
+SLICES = {0: ('burst', 'B'), 1: ('burst', 'E'), 5: ('display', 'B'), 6: ('display', 'E')}
+FAULTS = {4: 'hard fault', 5: 'bus fault', 6: 'usage fault', 7: 'clock table full', 8: 'bus subscribe failed'}
+
+
+def swo_payload(data, port):
+    """Concatenate the payloads of the ITM software packets of one stimulus port."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        header = data[i]
+        i += 1
+        if header in (0x00, 0x70, 0x80):
+            continue                                    # synchronisation / overflow
+        size = {1: 1, 2: 2, 3: 4}.get(header & 0x03, 0)
+        if size == 0:
+            while (header & 0x80) and i < len(data):    # time stamp / extension
+                header = data[i]
+                i += 1
+            continue
+        if not (header & 0x04) and (header >> 3) == port:
+            out += data[i:i + size]
+        i += size
+    return bytes(out)
+
+
+def read_recorder(data):
+    offset = 0
+    while True:
+        offset = data.find(struct.pack('<I', MAGIC), offset)
+        if offset < 0:
+            raise SystemExit('no trace recorder in the dump')
+        magic, size, head, enabled, hclk_hz, objects = HEADER.unpack_from(data, offset)
+        if size and (size & (size - 1)) == 0:
+            break
+        offset += 4
+
+    names = {}
+    base = offset + HEADER.size
+    for i in range(min(objects, OBJECTS)):
+        handle, name = OBJECT.unpack_from(data, base + i * OBJECT.size)
+        names[handle] = name.split(b'\0')[0].decode('ascii', errors='replace')
+
+    base += OBJECTS * OBJECT.size
+    events = []
+    torn = 0
+    for index in range(max(0, head - size), head):
+        cycles, ident, arg, sequence, value = EVENT.unpack_from(data, base + (index % size) * EVENT.size)
+        if sequence != (index & 0xFFFF):
+            torn += 1
+            continue
+        events.append((cycles, ident, arg, value))
+    return hclk_hz, head > size, names, events, torn
+
+
+def convert(hclk_hz, names, events):
+    out = []
+    threads = {}
+
+    def tid(name):
+        if name not in threads:
+            threads[name] = len(threads) + 1
+            out.append({'ph': 'M', 'pid': 1, 'tid': threads[name], 'name': 'thread_name', 'args': {'name': name}})
+        return threads[name]
+
+    def emit(ph, name, thread, ts, **extra):
+        event = {'ph': ph, 'pid': 1, 'tid': tid(thread), 'name': name, 'ts': round(ts, 3)}
+        event.update(extra)
+        out.append(event)
+
+    us = 0.0
+    previous = None
+    current = 'scheduler'
+    isr_stack = []
+    for cycles, ident, arg, value in events:
+        if previous is not None:
+            us += ((cycles - previous) & 0xFFFFFFFF) * 1e6 / hclk_hz
+        previous = cycles
+        context = ('IRQ ' + isr_stack[-1]) if isr_stack else current
+
+        if ident == ISR_ENTER:
+            irq = IRQS.get(arg, str(arg))
+            isr_stack.append(irq)
+            emit('B', irq, 'IRQ ' + irq, us)
+        elif ident == ISR_EXIT:
+            irq = IRQS.get(arg, str(arg))
+            if irq in isr_stack:
+                isr_stack.remove(irq)
+            emit('E', irq, 'IRQ ' + irq, us)
+        elif ident == TASK_IN:
+            current = names.get(value, '%08x' % value)
+            emit('B', current, current, us)
+        elif ident == TASK_OUT:
+            task = names.get(value, '%08x' % value)
+            emit('E', task, task, us)
+        elif ident in QUEUE_EVENTS:
+            queue = names.get(value, '%08x' % value)
+            emit('i', '%s %s' % (queue, QUEUE_EVENTS[ident]), context, us, s='t')
+        elif ident == CLOCK:
+            hclk_hz = value
+            emit('i', 'clock %d MHz' % (value // 1000000), 'power', us, s='p')
+        elif ident == SLEEP:
+            slept = value * 1e6 / hclk_hz if arg == POWER_SLEEP else float(value)
+            emit('X', 'STOP' if arg == POWER_STOP else 'SLEEP', 'power', us, dur=round(slept, 3))
+            us += slept
+        elif ident == MARK:
+            mark = MARKS[arg] if arg < len(MARKS) else 'mark %d' % arg
+            if arg in SLICES:
+                name, ph = SLICES[arg]
+                emit(ph, name, name, us, args={'data': value})
+            else:
+                emit('i', mark, 'markers', us, s='p', args={'data': value})
+        elif ident == FAULT:
+            emit('i', FAULTS.get(arg, 'fault %d' % arg), 'markers', us, s='g', args={'CFSR': '0x%08x' % value})
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description='trace dump to Chrome trace JSON')
+    parser.add_argument('dump')
+    parser.add_argument('--swo', action='store_true', help='raw SWO capture instead of a RAM dump')
+    parser.add_argument('--hz', type=int, default=96000000, help='core clock before the first clock event')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    if args.swo:
+        data = swo_payload(data, ITM_PORT)
+
+    hclk_hz, wrapped, names, events, torn = read_recorder(data)
+    if wrapped:
+        hclk_hz = args.hz
+    json.dump({'traceEvents': convert(hclk_hz, names, events), 'displayTimeUnit': 'ns'}, sys.stdout)
+    print('%d events, %d torn, %d named objects' % (len(events), torn, len(names)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
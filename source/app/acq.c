@@ -0,0 +1,132 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "acq.h"
+
+/*
+    Acquisition configuration and its validation (no register access - usable on
+    the host as well).
+*/
+
+/* the build configuration has to pass the same checks as a runtime one */
+_Static_assert((ACQ_BLOCK_SIZE % 8) == 0, "ACQ_BLOCK_SIZE must be a whole number of DMA bursts (8 samples)");
+_Static_assert((ACQ_BLOCK_SIZE > 0) && (ACQ_BLOCK_SIZE <= (ACQ_POOL_SAMPLES / 2)), "ACQ_BLOCK_SIZE does not fit in the pool");
+_Static_assert(ACQ_BURST_BLOCKS > 0, "ACQ_BURST_BLOCKS must be at least one");
+_Static_assert(ACQ_PERIOD_MS >= 10, "ACQ_PERIOD_MS too short");
+_Static_assert((ACQ_CHANNEL == 8) || (ACQ_CHANNEL == 9), "ACQ_CHANNEL must be 8 (PB0) or 9 (PB1)");
+_Static_assert(ACQ_SMP_CODE(ACQ_SAMPLE_CYCLES) < 8, "ACQ_SAMPLE_CYCLES is not an ADC sampling time");
+_Static_assert(((uint64_t)ACQ_BLOCK_SIZE * ACQ_BURST_BLOCKS * 1000) <= ((uint64_t)ACQ_SAMPLE_RATE(ACQ_SAMPLE_CYCLES, ACQ_ADC_HZ) * ACQ_PERIOD_MS),
+    "the ADC clock cannot sample the burst within ACQ_PERIOD_MS");
+_Static_assert(ACQ_ADC_HZ <= CLOCK_ADC_MIN_HZ, "ACQ_ADC_HZ above the slowest ADC clock of the profiles");
+_Static_assert((((uint64_t)ACQ_VREF_UV << ACQ_SCALE_SHIFT) / ((uint64_t)ACQ_FULL_SCALE * 8)) <= UINT32_MAX, "ACQ_VREF_UV too large for the Q24 scale");
+
+const acq_config_t acq_default_config = {
+    .block_size     = ACQ_BLOCK_SIZE,
+    .burst_blocks   = ACQ_BURST_BLOCKS,
+    .period_ms      = ACQ_PERIOD_MS,
+    .channel        = ACQ_CHANNEL,
+    .sample_cycles  = ACQ_SAMPLE_CYCLES
+};
+
+/* derived from the build configuration at compile time (1 ms tick) */
+const acq_derived_t acq_default_derived = {
+    .smp_code       = ACQ_SMP_CODE(ACQ_SAMPLE_CYCLES),
+    .buffer_words   = ACQ_BLOCK_SIZE / 2,
+    .scale_q24      = ACQ_SCALE_Q24(ACQ_BLOCK_SIZE),
+    .duty_q16       = ACQ_DUTY_Q16(ACQ_PERIOD_MS)
+};
+
+/**
+ * SMP register code for a sampling time (8 - not valid)
+ */
+uint32_t acq_sample_time_code(const uint32_t sample_cycles)
+{
+    return ACQ_SMP_CODE(sample_cycles);
+}
+
+/**
+ * the constants of the sampling path for a validated configuration (same formulas
+ * as acq_default_derived)
+ */
+void acq_derive(const acq_config_t *config, const uint32_t tick_ms, acq_derived_t *derived)
+{
+    derived->smp_code       = ACQ_SMP_CODE(config->sample_cycles);
+    derived->buffer_words   = config->block_size / 2;
+    derived->scale_q24      = ACQ_SCALE_Q24(config->block_size);
+    derived->duty_q16       = ACQ_DUTY_Q16(config->period_ms / tick_ms);
+}
+
+/**
+ * conversions per second at the given ADC clock
+ */
+uint32_t acq_sample_rate(const acq_config_t *config, const uint32_t adc_hz)
+{
+    return adc_hz / (config->sample_cycles + ACQ_CONVERSION_CYCLES);
+}
+
+/**
+ * time between two samples in us (Q16.16) at the given ADC clock
+ */
+uint32_t acq_sample_period_q16(const uint32_t sample_cycles, const uint32_t adc_hz)
+{
+    return (uint32_t)((((uint64_t)(sample_cycles + ACQ_CONVERSION_CYCLES) * 1000000) << 16) / adc_hz);
+}
+
+/**
+ * samples captured per second (bursts included)
+ */
+uint32_t acq_throughput(const acq_config_t *config)
+{
+    return (uint32_t)(((uint64_t)config->block_size * config->burst_blocks * 1000) / config->period_ms);
+}
+
+acq_error_t acq_config_check(const acq_config_t *config, const uint32_t adc_hz)
+{
+    if ((config->block_size == 0) || ((config->block_size % 8) != 0) || (config->block_size > (ACQ_POOL_SAMPLES / 2))) {
+        return ACQ_ERROR_BLOCK_SIZE;
+    }
+    if (config->burst_blocks == 0) {
+        return ACQ_ERROR_BURST;
+    }
+    if (config->period_ms < 10) {
+        return ACQ_ERROR_PERIOD;
+    }
+    if ((config->channel != 8) && (config->channel != 9)) {
+        return ACQ_ERROR_CHANNEL;
+    }
+    if (acq_sample_time_code(config->sample_cycles) >= 8) {
+        return ACQ_ERROR_SAMPLE_TIME;
+    }
+
+    /* the burst has to be done within the window */
+    uint64_t burst_samples = (uint64_t)config->block_size * config->burst_blocks;
+    if ((burst_samples * 1000) > ((uint64_t)acq_sample_rate(config, adc_hz) * config->period_ms)) {
+        return ACQ_ERROR_RATE;
+    }
+
+    return ACQ_OK;
+}
@@ -0,0 +1,104 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include <stdint.h>
+#include "clock_profile.h"
+
+/* build configuration of the acquisition pipeline (the console starts from it and
+   can change the first five at runtime); checked at compile time in acq.c */
+#define ACQ_BLOCK_SIZE          1000        /* samples per block */
+#define ACQ_BURST_BLOCKS        1           /* blocks per sampling window */
+#define ACQ_PERIOD_MS           250         /* sampling window (matches the display refresh) */
+#define ACQ_CHANNEL             8           /* PB0 */
+#define ACQ_SAMPLE_CYCLES       480         /* sampling time in ADC cycles */
+#define ACQ_VREF_UV             3312000     /* ADC reference in uV (measured on the board) */
+#define ACQ_ADC_HZ              CLOCK_ADC_MIN_HZ    /* any profile can be active: the slowest ADC clock */
+
+/* DMA buffer pool: both buffers of a block are carved from it */
+#define ACQ_POOL_SAMPLES        8000
+
+/* successive approximation cycles and full scale of a 12 bit conversion */
+#define ACQ_CONVERSION_CYCLES   12
+#define ACQ_FULL_SCALE          4096
+
+/* SMP register code of a sampling time (8 - not valid) */
+#define ACQ_SMP_CODE(cycles)                                                            \
+    (((cycles) == 3)   ? 0U : ((cycles) == 15)  ? 1U : ((cycles) == 28)  ? 2U :         \
+     ((cycles) == 56)  ? 3U : ((cycles) == 84)  ? 4U : ((cycles) == 112) ? 5U :         \
+     ((cycles) == 144) ? 6U : ((cycles) == 480) ? 7U : 8U)
+
+/* conversions per second */
+#define ACQ_SAMPLE_RATE(cycles, adc_hz)     ((adc_hz) / ((cycles) + ACQ_CONVERSION_CYCLES))
+
+/* uV per LSB of a block sum in Q24: uV = (sum * scale) >> 24 (fits 32 bits for any valid block) */
+#define ACQ_SCALE_SHIFT                     24
+#define ACQ_SCALE_Q24(length)               \
+    ((uint32_t)(((uint64_t)ACQ_VREF_UV << ACQ_SCALE_SHIFT) / ((uint64_t)ACQ_FULL_SCALE * (length))))
+
+/* duty cycle in per mille per tick of the window in Q16 */
+#define ACQ_DUTY_Q16(period_ticks)          ((uint32_t)((1000UL << 16) / (period_ticks)))
+
+/* acquisition parameters that can be changed at runtime */
+typedef struct acq_config_t {
+    uint32_t block_size;        /* samples per block (multiple of 8) */
+    uint32_t burst_blocks;      /* blocks per sampling window */
+    uint32_t period_ms;         /* sampling window / display period */
+    uint32_t channel;           /* ADC channel: 8 (PB0) or 9 (PB1) */
+    uint32_t sample_cycles;     /* 3, 15, 28, 56, 84, 112, 144 or 480 ADC cycles */
+} acq_config_t;
+
+/* validation results */
+typedef enum acq_error_t {
+    ACQ_OK,
+    ACQ_ERROR_BLOCK_SIZE,       /* not a multiple of 8 or does not fit in the pool */
+    ACQ_ERROR_BURST,            /* no block in the window */
+    ACQ_ERROR_PERIOD,           /* window too short */
+    ACQ_ERROR_CHANNEL,          /* channel without an analog pin */
+    ACQ_ERROR_SAMPLE_TIME,      /* not a valid sampling time */
+    ACQ_ERROR_RATE              /* the burst does not fit in the window at this ADC clock */
+} acq_error_t;
+
+/* everything the per block code needs, derived once per configuration so that the
+   sampling path has no division and no decision on the configuration */
+typedef struct acq_derived_t {
+    uint32_t smp_code;          /* SMP register field */
+    uint32_t buffer_words;      /* size of one DMA buffer (two samples per word) */
+    uint32_t scale_q24;         /* uV per LSB of a block sum */
+    uint32_t duty_q16;          /* per mille of the window per tick */
+} acq_derived_t;
+
+extern const acq_config_t acq_default_config;
+extern const acq_derived_t acq_default_derived;
+
+acq_error_t acq_config_check(const acq_config_t *config, const uint32_t adc_hz);
+uint32_t acq_sample_time_code(const uint32_t sample_cycles);
+uint32_t acq_sample_rate(const acq_config_t *config, const uint32_t adc_hz);
+uint32_t acq_sample_period_q16(const uint32_t sample_cycles, const uint32_t adc_hz);
+uint32_t acq_throughput(const acq_config_t *config);
+void acq_derive(const acq_config_t *config, const uint32_t tick_ms, acq_derived_t *derived);
@@ -26,16 +26,28 @@
  |___________________________________________________________________________*/
 
 #include "stm32f4xx.h"
+#include "system.h"
+#include "clock.h"
+#include "gpio.h"
 #include "adc.h"
 
+/* sampling time of the selected channel in ADC cycles */
+static uint32_t adc_sample_cycles = 0;
+
+/* time between two samples in us (Q16.16) */
+static volatile uint32_t adc_period_q16 = 0;
+
+/* ADC inputs on PB0 (channel 8) and PB1 (channel 9): analog, no pull up, no pull down */
+static const gpio_pinset_t adc_pins[] = {
+    GPIO_PINSET_MODE_PULL(GPIOB, GPIO_ODR_OD0, GPIO_MODE_ANALOG, GPIO_PULL_NONE),
+    GPIO_PINSET_MODE_PULL(GPIOB, GPIO_ODR_OD1, GPIO_MODE_ANALOG, GPIO_PULL_NONE)
+};
+
 void adc_init()
 {
-    /* set the pis B0 as input ADC */
-    MODIFY_REG(GPIOB->MODER, GPIO_MODER_MODER0_Msk, 11);      /* set the pin as analog */
-    MODIFY_REG(GPIOB->PUPDR, GPIO_PUPDR_PUPD0_Msk,  0);       /* no pull up, no pull down */
-
-    /* ADC prescalar 8 */
-    MODIFY_REG(ADC1_COMMON->CCR, ADC_CCR_ADCPRE_Msk, ADC_CCR_ADCPRE_0 | ADC_CCR_ADCPRE_1);
+    /* ADC prescalar from the clock profile (8 at 96MHz) */
+    adc_clock_changed(clock_get_info());
+    clock_register_listener(adc_clock_changed);
 
     /* 12 bit ADC with dma enable */
     MODIFY_REG(ADC1->CR1, ADC_CR1_RES_Msk, 0);
@@ -43,29 +55,69 @@ void adc_init()
     MODIFY_REG(ADC1->CR2, ADC_CR2_DMA_Msk, ADC_CR2_DMA);
     MODIFY_REG(ADC1->CR2, ADC_CR2_DDS_Msk, ADC_CR2_DDS);
 
-    /* select B0 channel for conversion */
+    /* one conversion in the regular sequence: B0 with 480 ADC cycles by default */
     MODIFY_REG(ADC1->SQR1, ADC_SQR1_L_Msk, 0);
-    MODIFY_REG(ADC1->SQR3, ADC_SQR3_SQ1_Msk, (8 << ADC_SQR3_SQ1_Pos));
-
-    /* select 480 ADC cycles */
-    MODIFY_REG(ADC1->SMPR2, ADC_SMPR2_SMP8_Msk, ADC_SMPR2_SMP8_0 | ADC_SMPR2_SMP8_1 | ADC_SMPR2_SMP8_2);
-
+    adc_configure(&acq_default_config, &acq_default_derived);
 
     /*
-        ADCCLK = 48MHz/8 = 6MHZ -> 0.0000001666...
+        ADCCLK = 48MHz/8 = 6MHZ -> 0.0000001666... (CLOCK_PROFILE_PERFORMANCE)
         Conversion time = 480+15 cycles * 1000 = 0.0000825 s * 1000 = 0.0825
     */
 }
 
+/**
+ * select the converted channel (8 or 9) and its sampling time (validated by
+ * acq_config_check). Only called while the ADC is off.
+ */
+void adc_configure(const acq_config_t *config, const acq_derived_t *derived)
+{
+    const uint32_t channel = config->channel;
+
+    gpio_apply(&adc_pins[channel - 8]);
+    MODIFY_REG(ADC1->SQR3, ADC_SQR3_SQ1_Msk, (channel << ADC_SQR3_SQ1_Pos));
+
+    /* channels 0..9 have their 3 bit SMP fields in SMPR2 */
+    MODIFY_REG(ADC1->SMPR2, ADC_SMPR2_SMP0_Msk << (3 * channel), derived->smp_code << (3 * channel));
+
+    adc_sample_cycles = config->sample_cycles;
+    adc_clock_changed(clock_get_info());
+}
+
+/**
+ * clock listener: keep the ADC clock below the target for the new APB2 clock
+ * Only called while the ADC is off.
+ */
+void adc_clock_changed(const clock_info_t *info)
+{
+    MODIFY_REG(ADC1_COMMON->CCR, ADC_CCR_ADCPRE_Msk, ((info->adc_prescaler / 2) - 1) << ADC_CCR_ADCPRE_Pos);
+    adc_period_q16 = acq_sample_period_q16(adc_sample_cycles, info->adc_hz);
+}
+
+/**
+ * time between two samples in us (Q16.16) for the current ADC clock
+ */
+uint32_t adc_sample_period_q16()
+{
+    return adc_period_q16;
+}
+
 void adc_enable()
 {  
+    /* clear a pending overrun and re-arm the DMA requests (needed after a power down) */
+    CLEAR_BIT(ADC1->SR, ADC_SR_OVR_Msk);
+    MODIFY_REG(ADC1->CR2, ADC_CR2_DMA_Msk, 0);
+    MODIFY_REG(ADC1->CR2, ADC_CR2_DMA_Msk, ADC_CR2_DMA);
+
      /* ADC ON */
     MODIFY_REG(ADC1->CR2, ADC_CR2_ADON_Msk, ADC_CR2_ADON);
+
+    /* wait for the ADC to stabilize (tSTAB max. 3us) before starting the conversions */
+    delay_us(3);
     MODIFY_REG(ADC1->CR2, ADC_CR2_SWSTART_Msk, ADC_CR2_SWSTART);
 }
 
 void adc_disable()
 {
-    /* ADC 1 OFF */
+    /* ADC 1 OFF - this also stops the continuous conversion and puts the ADC in power down */
     MODIFY_REG(ADC1->CR2, ADC_CR2_ADON_Msk, 0);
 }
@@ -27,6 +27,12 @@
  
 #pragma once
 
+#include "clock_profile.h"
+#include "acq.h"
+
 void adc_init();
 void adc_enable();
 void adc_disable();
+void adc_configure(const acq_config_t *config, const acq_derived_t *derived);
+void adc_clock_changed(const clock_info_t *info);
+uint32_t adc_sample_period_q16();
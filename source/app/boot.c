@@ -0,0 +1,119 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "clock.h"
+#include "trace.h"
+#include "boot.h"
+
+/*
+    The DWT cycle counter is started first thing in main() and converted to us at
+    every mark with the core clock valid since the previous mark (the clock changes
+    from HSI to PLL during the boot, see boot_clock_changed). The counter does not
+    run while the core sleeps - the low power module keeps the core awake until the
+    first reading is available.
+*/
+
+boot_profile_t boot_profile = {0};
+
+/* time accounted so far */
+static uint32_t boot_us = 0;
+static uint32_t boot_cycles = 0;
+static uint32_t boot_hz = 0;
+
+static volatile uint32_t boot_completed = 0;
+
+static void boot_sync()
+{
+    uint32_t now = DWT->CYCCNT;
+
+    boot_us += (now - boot_cycles) / (boot_hz / 1000000);
+    boot_cycles = now;
+    boot_hz = clock_get_info()->hclk_hz;
+}
+
+void boot_init()
+{
+    /* enable DWT */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    boot_hz = clock_get_info()->hclk_hz;
+    clock_register_listener(boot_clock_changed);
+}
+
+/**
+ * record the time a phase completed (the first time only)
+ */
+void boot_mark(const boot_phase_t phase)
+{
+    if (boot_completed || (boot_profile.timestamp_us[phase] != 0)) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    boot_sync();
+    boot_profile.timestamp_us[phase] = boot_us;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * report a driver that failed to initialize (the boot continues without it)
+ */
+void boot_fail(const boot_failure_t failure)
+{
+    boot_profile.failures |= failure;
+    trace_mark(TRACE_MARK_BOOT_FAIL, boot_profile.failures);
+}
+
+/**
+ * end of the boot - called after the first sampling window (the PLL switch is done
+ * at the end of it); from now on the core may sleep
+ */
+void boot_complete()
+{
+    boot_completed = 1;
+}
+
+uint32_t boot_done()
+{
+    return boot_completed;
+}
+
+/**
+ * clock listener: account the elapsed cycles with the previous clock
+ */
+void boot_clock_changed(const clock_info_t *info)
+{
+    if (info->id == CLOCK_PROFILE_PERFORMANCE) {
+        boot_mark(BOOT_PHASE_PLL);
+    } else if (!boot_completed) {
+        boot_sync();
+    }
+}
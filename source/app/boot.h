@@ -0,0 +1,68 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include "clock_profile.h"
+
+/* boot phases in the order they normally complete */
+typedef enum boot_phase_t {
+    BOOT_PHASE_SYSTEM,          /* running on HSI, HSE started */
+    BOOT_PHASE_GPIO,
+    BOOT_PHASE_ISR,
+    BOOT_PHASE_POWER,
+    BOOT_PHASE_DMA,
+    BOOT_PHASE_ADC,
+    BOOT_PHASE_LCD,
+    BOOT_PHASE_SCHEDULER,       /* first task running */
+    BOOT_PHASE_SAMPLING,        /* ADC and DMA started */
+    BOOT_PHASE_FIRST_READING,   /* first block converted to a voltage */
+    BOOT_PHASE_PLL,             /* switched to the PLL profile */
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+/* hardware that did not come up during the boot (bit mask) */
+typedef enum boot_failure_t {
+    BOOT_FAIL_LSI   = (1 << 0),   /* LSI not ready - no RTC, STOP disabled */
+    BOOT_FAIL_RTC   = (1 << 1),   /* RTC init / wakeup timer not accessible - STOP disabled */
+    BOOT_FAIL_DMA   = (1 << 2)    /* the DMA stream did not disable */
+} boot_failure_t;
+
+/* startup profile: time in us since main() for each phase (0 - not reached) */
+typedef struct boot_profile_t {
+    uint32_t timestamp_us[BOOT_PHASE_COUNT];
+    uint32_t failures;          /* boot_failure_t */
+} boot_profile_t;
+
+extern boot_profile_t boot_profile;
+
+void boot_init();
+void boot_mark(const boot_phase_t phase);
+void boot_fail(const boot_failure_t failure);
+void boot_complete();
+uint32_t boot_done();
+void boot_clock_changed(const clock_info_t *info);
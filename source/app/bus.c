@@ -0,0 +1,197 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <string.h>
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "queue.h"
+#include "trace.h"
+#include "bus.h"
+
+/*
+    Measurement bus: the sampler publishes every block once into a slot of a static
+    pool and the subscribers get a pointer to it. A slot is reference counted - one
+    reference per subscriber queue it was put in - and goes back to the pool with
+    the last release. The producer never blocks: a full queue or an empty pool is
+    counted.
+
+    The raw samples are not copied: the view points into the DMA buffer which is
+    refilled when the next block completes or the next burst starts. The DMA moves
+    the epoch forward at these points; a subscriber reads the samples and then
+    checks bus_raw_valid() to know if the data it used was still intact.
+*/
+
+bus_stats_t bus_stats = {0};
+
+static bus_block_t bus_slots[BUS_SLOTS];
+static bus_subscriber_t bus_subscribers[BUS_SUBSCRIBERS];
+static uint32_t bus_subscribers_count = 0;
+
+/* moved forward every time a DMA buffer may be overwritten */
+static volatile uint32_t bus_epoch = 0;
+
+/**
+ * subscribe (before the scheduler starts); depth is the queue length of a lossless
+ * subscriber. NULL - no subscriber left (BUS_SUBSCRIBERS), name longer than
+ * BUS_NAME_MAX or no heap for the queue.
+ */
+bus_subscriber_t *bus_subscribe(const char *name, const bus_mode_t mode, const uint32_t depth)
+{
+    if ((bus_subscribers_count >= BUS_SUBSCRIBERS) || (strlen(name) > BUS_NAME_MAX)) {
+        return NULL;
+    }
+
+    QueueHandle_t queue = xQueueCreate((mode == BUS_MODE_LATEST) ? 1 : depth, sizeof(bus_block_t *));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    bus_subscriber_t *subscriber = &bus_subscribers[bus_subscribers_count++];
+    subscriber->name = name;
+    subscriber->mode = mode;
+    subscriber->queue = queue;
+    trace_name(subscriber->queue, name);
+
+    return subscriber;
+}
+
+uint32_t bus_subscriber_count()
+{
+    return bus_subscribers_count;
+}
+
+const bus_subscriber_t *bus_subscriber(const uint32_t index)
+{
+    return (index < bus_subscribers_count) ? &bus_subscribers[index] : NULL;
+}
+
+/**
+ * a free slot for the producer (NULL - all in use)
+ */
+bus_block_t *bus_claim()
+{
+    bus_block_t *block = NULL;
+
+    taskENTER_CRITICAL();
+    for (uint32_t i = 0; i < BUS_SLOTS; i++) {
+        if (bus_slots[i].refs == 0) {
+            block = &bus_slots[i];
+            block->refs = 1;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (block == NULL) {
+        bus_stats.no_slot++;
+    }
+    return block;
+}
+
+static void bus_retain(bus_block_t *block)
+{
+    taskENTER_CRITICAL();
+    block->refs++;
+    taskEXIT_CRITICAL();
+}
+
+void bus_release(const bus_block_t *block)
+{
+    bus_block_t *slot = (bus_block_t *)block;
+
+    taskENTER_CRITICAL();
+    if (slot->refs > 0) {
+        slot->refs--;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * hand a claimed block to all the subscribers (never blocks)
+ */
+void bus_publish(bus_block_t *block)
+{
+    block->index = bus_stats.published++;
+
+    for (uint32_t i = 0; i < bus_subscribers_count; i++) {
+        bus_subscriber_t *subscriber = &bus_subscribers[i];
+
+        bus_retain(block);
+        if (subscriber->mode == BUS_MODE_LATEST) {
+            /* take back the block not read yet - only the producer fills the queue */
+            bus_block_t *old;
+            if (xQueueReceive(subscriber->queue, &old, (TickType_t) 0) == pdPASS) {
+                subscriber->dropped++;
+                bus_release(old);
+            }
+            xQueueSendToBack(subscriber->queue, &block, (TickType_t) 0);
+        } else if (xQueueSendToBack(subscriber->queue, &block, (TickType_t) 0) != pdPASS) {
+            subscriber->dropped++;
+            bus_release(block);
+        }
+    }
+
+    /* the reference of the producer */
+    bus_release(block);
+}
+
+/**
+ * next block for a subscriber (NULL on timeout); to be released after use
+ */
+const bus_block_t *bus_receive(bus_subscriber_t *subscriber, const TickType_t timeout)
+{
+    bus_block_t *block;
+
+    if (xQueueReceive(subscriber->queue, &block, timeout) != pdPASS) {
+        return NULL;
+    }
+
+    subscriber->received++;
+    subscriber->lag = bus_stats.published - block->index - 1;
+    if (subscriber->lag > subscriber->lag_max) {
+        subscriber->lag_max = subscriber->lag;
+    }
+    return block;
+}
+
+/**
+ * called by the DMA when a buffer starts to be refilled (interupt or parked stream);
+ * returns the epoch of the block just completed
+ */
+uint32_t bus_raw_advance()
+{
+    return ++bus_epoch;
+}
+
+/**
+ * the raw view of the block was not overwritten (check after reading the samples)
+ */
+uint32_t bus_raw_valid(const bus_block_t *block)
+{
+    return block->raw_epoch == bus_epoch;
+}
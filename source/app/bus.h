@@ -0,0 +1,89 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include "stm32rtos.h"
+#include "queue.h"
+
+/* blocks in flight (published and not yet released by all the subscribers) */
+#define BUS_SLOTS               32
+#define BUS_SUBSCRIBERS         4
+
+/* longest subscriber name (sizes the bus line of the console) */
+#define BUS_NAME_MAX            12
+
+/* delivery semantics of a subscription */
+typedef enum bus_mode_t {
+    BUS_MODE_LATEST,            /* only the newest block is kept, older ones are replaced */
+    BUS_MODE_LOSSLESS           /* every block in order (queue depth); an overflow is counted */
+} bus_mode_t;
+
+/* one published block: result and a view of the raw samples (read only for the
+   subscribers, back to the pool when the last one releases it) */
+typedef struct bus_block_t {
+    uint32_t index;             /* publication counter */
+    uint32_t sequence;          /* block counter of the sampler */
+    uint32_t digital_value;     /* sum of the samples */
+    uint32_t microvolts;        /* block mean */
+    uint32_t duty_cycle;        /* active part of the sampling window in per mille */
+    uint16_t length;            /* number of samples */
+    uint64_t timestamp_us;      /* time of the first sample */
+    uint64_t sample_index;      /* index of the first sample since the start */
+    const uint32_t *raw;        /* packed samples in the DMA buffer - see bus_raw_valid */
+    uint32_t raw_epoch;
+    volatile uint32_t refs;
+} bus_block_t;
+
+typedef struct bus_subscriber_t {
+    const char *name;
+    bus_mode_t mode;
+    QueueHandle_t queue;
+    volatile uint32_t received;
+    volatile uint32_t dropped;  /* replaced (latest) / did not fit in the queue (lossless) */
+    uint32_t lag;               /* blocks published after the last received one */
+    uint32_t lag_max;
+} bus_subscriber_t;
+
+typedef struct bus_stats_t {
+    volatile uint32_t published;
+    volatile uint32_t no_slot;  /* blocks not published: all the slots in use */
+} bus_stats_t;
+
+extern bus_stats_t bus_stats;
+
+bus_subscriber_t *bus_subscribe(const char *name, const bus_mode_t mode, const uint32_t depth);
+uint32_t bus_subscriber_count();
+const bus_subscriber_t *bus_subscriber(const uint32_t index);
+
+bus_block_t *bus_claim();
+void bus_publish(bus_block_t *block);
+const bus_block_t *bus_receive(bus_subscriber_t *subscriber, const TickType_t timeout);
+void bus_release(const bus_block_t *block);
+
+uint32_t bus_raw_advance();
+uint32_t bus_raw_valid(const bus_block_t *block);
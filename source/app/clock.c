@@ -0,0 +1,353 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "system.h"
+#include "trace.h"
+#include "clock.h"
+
+/* oscillator timeouts in us (HSE start up depends on the crystal) */
+#define CLOCK_TIMEOUT_HSI_US        2000
+#define CLOCK_TIMEOUT_HSE_US        100000
+#define CLOCK_TIMEOUT_PLL_US        2000
+#define CLOCK_TIMEOUT_SWITCH_US     5000
+
+/* active clock configuration (until system_init: the HSI profile) */
+static clock_info_t clock_info = CLOCK_INFO_HSI;
+
+/* profile requested to be applied at the next safe point */
+static volatile int32_t clock_requested = -1;
+
+/* drivers depending on the clock */
+static clock_listener_t clock_listeners[CLOCK_LISTENERS_MAX] = {0};
+static uint32_t clock_listeners_count = 0;
+
+/* drivers that can veto a profile switch */
+static clock_check_t clock_checks[CLOCK_CHECKS_MAX] = {0};
+static uint32_t clock_checks_count = 0;
+
+static uint32_t clock_hpre_bits(const uint32_t div)
+{
+    /* 1 -> 0000, 2 -> 1000, 4 -> 1001, ... 64 -> 1100 (there is no /32), 512 -> 1111 */
+    uint32_t bits = 0;
+    if (div > 1) {
+        uint32_t log2 = 0;
+        for (uint32_t d = div; d > 1; d >>= 1) {
+            log2++;
+        }
+        bits = 0x8 | (log2 > 5 ? log2 - 2 : log2 - 1);
+    }
+    return bits << RCC_CFGR_HPRE_Pos;
+}
+
+static uint32_t clock_ppre_bits(const uint32_t div)
+{
+    /* 1 -> 000, 2 -> 100, 4 -> 101, 8 -> 110, 16 -> 111 */
+    uint32_t bits = 0;
+    if (div > 1) {
+        uint32_t log2 = 0;
+        for (uint32_t d = div; d > 1; d >>= 1) {
+            log2++;
+        }
+        bits = 0x4 | (log2 - 1);
+    }
+    return bits;
+}
+
+static uint32_t clock_vos_bits(const uint32_t vos)
+{
+    /* scale 1 -> 11, scale 2 -> 10, scale 3 -> 01 */
+    return (4 - vos) << PWR_CR_VOS_Pos;
+}
+
+static clock_error_t clock_configure(const clock_profile_t *profile, const clock_info_t *info)
+{
+    /* run from the HSI while the PLL and the regulator are reconfigured */
+    SET_BIT(RCC->CR, RCC_CR_HSION);
+    if (!system_wait(&RCC->CR, RCC_CR_HSIRDY_Msk, RCC_CR_HSIRDY, CLOCK_TIMEOUT_HSI_US)) {
+        return CLOCK_ERROR_TIMEOUT;
+    }
+
+    /* keep the higher of the old/new wait states during the switch */
+    if (info->flash_latency > (FLASH->ACR & FLASH_ACR_LATENCY_Msk)) {
+        MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY_Msk, info->flash_latency << FLASH_ACR_LATENCY_Pos);
+    }
+
+    /* set the highest APBx dividers in order to ensure that we do not go through
+        a non-spec phase whatever we decrease or increase HCLK. */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE1_Msk, RCC_CFGR_PPRE1_DIV16);
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2_Msk, RCC_CFGR_PPRE2_DIV16);
+
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW_Msk, RCC_CFGR_SW_HSI);
+    if (!system_wait(&RCC->CFGR, RCC_CFGR_SWS_Msk, RCC_CFGR_SWS_HSI, CLOCK_TIMEOUT_SWITCH_US)) {
+        return CLOCK_ERROR_TIMEOUT;
+    }
+
+    /* the PLL can only be reconfigured while off; the new voltage scale is taken into
+       account when the PLL is enabled */
+    CLEAR_BIT(RCC->CR, RCC_CR_PLLON);
+    if (!system_wait(&RCC->CR, RCC_CR_PLLRDY_Msk, 0, CLOCK_TIMEOUT_PLL_US)) {
+        return CLOCK_ERROR_TIMEOUT;
+    }
+    MODIFY_REG(PWR->CR, PWR_CR_VOS, clock_vos_bits(profile->vos));
+
+    if (profile->source != CLOCK_SOURCE_HSI) {
+        /* enable the external High Speed Clock (normally already started) */
+        SET_BIT(RCC->CR, RCC_CR_HSEON);
+        if (!system_wait(&RCC->CR, RCC_CR_HSERDY_Msk, RCC_CR_HSERDY, CLOCK_TIMEOUT_HSE_US)) {
+            return CLOCK_ERROR_TIMEOUT;
+        }
+    }
+
+    if (profile->source == CLOCK_SOURCE_PLL) {
+        /* configure the PLL */
+        MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLSRC_Msk, RCC_PLLCFGR_PLLSRC_HSE);
+        MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLM_Msk, profile->pllm << RCC_PLLCFGR_PLLM_Pos);
+        MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLN_Msk, profile->plln << RCC_PLLCFGR_PLLN_Pos);
+        MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLP_Msk, ((profile->pllp / 2) - 1) << RCC_PLLCFGR_PLLP_Pos);
+        MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLQ_Msk, profile->pllq << RCC_PLLCFGR_PLLQ_Pos);
+
+        /* enable PLL clock generation */
+        SET_BIT(RCC->CR, RCC_CR_PLLON);
+        if (!system_wait(&RCC->CR, RCC_CR_PLLRDY_Msk, RCC_CR_PLLRDY, CLOCK_TIMEOUT_PLL_US)) {
+            return CLOCK_ERROR_TIMEOUT;
+        }
+
+        /* the regulator must be ready before running at the new frequency
+           (without the PLL the scale 3 is used) */
+        if (!system_wait(&PWR->CSR, PWR_CSR_VOSRDY_Msk, PWR_CSR_VOSRDY, CLOCK_TIMEOUT_PLL_US)) {
+            return CLOCK_ERROR_TIMEOUT;
+        }
+    }
+
+    /* select the new SYSCLK */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE_Msk, clock_hpre_bits(profile->hpre));
+    switch (profile->source) {
+        case CLOCK_SOURCE_PLL:
+            MODIFY_REG(RCC->CFGR, RCC_CFGR_SW_Msk, RCC_CFGR_SW_PLL);
+            if (!system_wait(&RCC->CFGR, RCC_CFGR_SWS_Msk, RCC_CFGR_SWS_PLL, CLOCK_TIMEOUT_SWITCH_US)) {
+                return CLOCK_ERROR_TIMEOUT;
+            }
+            break;
+
+        case CLOCK_SOURCE_HSE:
+            MODIFY_REG(RCC->CFGR, RCC_CFGR_SW_Msk, RCC_CFGR_SW_HSE);
+            if (!system_wait(&RCC->CFGR, RCC_CFGR_SWS_Msk, RCC_CFGR_SWS_HSE, CLOCK_TIMEOUT_SWITCH_US)) {
+                return CLOCK_ERROR_TIMEOUT;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* now the wait states can be lowered */
+    MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY_Msk, info->flash_latency << FLASH_ACR_LATENCY_Pos);
+
+    /* confgure the APB clocks */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE1_Msk, clock_ppre_bits(profile->ppre1) << RCC_CFGR_PPRE1_Pos);
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2_Msk, clock_ppre_bits(profile->ppre2) << RCC_CFGR_PPRE2_Pos);
+
+    /* switch off the HSI if not used (the HSE is kept running once started) */
+    if (profile->source != CLOCK_SOURCE_HSI) {
+        CLEAR_BIT(RCC->CR, RCC_CR_HSION);
+    }
+
+    /* one us timer for delay */
+    TIM10->PSC = (info->tim_apb2_hz / 1000000) - 1;
+    SET_BIT(TIM10->EGR, TIM_EGR_UG);
+
+    /* keep the RTOS tick rate (the scheduler starts the SysTick with clock_hclk_hz(),
+       see configCPU_CLOCK_HZ in freertos_config.h) */
+    SysTick->LOAD = (info->hclk_hz / configTICK_RATE_HZ) - 1;
+    SysTick->VAL = 0;
+
+    return CLOCK_OK;
+}
+
+static void clock_notify()
+{
+    for (uint32_t i = 0; i < clock_listeners_count; i++) {
+        clock_listeners[i](&clock_info);
+    }
+}
+
+static uint32_t clock_accepted(const clock_info_t *info)
+{
+    for (uint32_t i = 0; i < clock_checks_count; i++) {
+        if (!clock_checks[i](info)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * fall back to the HSI if an oscillator failed (not subject to the checks - there is
+ * no other clock left)
+ */
+static void clock_fallback()
+{
+    clock_info_t info;
+
+    clock_profile_check(&clock_profiles[CLOCK_PROFILE_HSI], &info);
+    info.id = CLOCK_PROFILE_HSI;
+    clock_configure(&clock_profiles[CLOCK_PROFILE_HSI], &info);
+    CLEAR_BIT(RCC->CR, RCC_CR_HSEON);
+
+    clock_info = info;
+    clock_notify();
+}
+
+/**
+ * switch to a clock profile and notify the dependent drivers
+ * The caller must make sure that no driver is using a clock (i.e. the ADC is parked).
+ * A profile rejected by a registered check is not applied (CLOCK_ERROR_REJECTED).
+ * On an oscillator timeout the HSI profile is selected.
+ */
+clock_error_t clock_set_profile(const clock_profile_id_t id)
+{
+    clock_info_t info;
+    clock_error_t error;
+
+    if (id >= CLOCK_PROFILE_COUNT) {
+        return CLOCK_ERROR_PROFILE;
+    }
+
+    error = clock_profile_check(&clock_profiles[id], &info);
+    if (error != CLOCK_OK) {
+        return error;
+    }
+    info.id = id;
+
+    if (!clock_accepted(&info)) {
+        trace_mark(TRACE_MARK_CLOCK_REJECTED, id);
+        return CLOCK_ERROR_REJECTED;
+    }
+
+    error = clock_configure(&clock_profiles[id], &info);
+    if (error != CLOCK_OK) {
+        clock_fallback();
+        return error;
+    }
+
+    clock_info = info;
+    clock_notify();
+
+    return CLOCK_OK;
+}
+
+/**
+ * reconfigure the active profile (after a wake up from STOP the HSI is selected)
+ */
+void clock_restore()
+{
+    if (clock_configure(&clock_profiles[clock_info.id], &clock_info) != CLOCK_OK) {
+        clock_fallback();
+    }
+}
+
+/**
+ * start the crystal without waiting for it
+ */
+void clock_start_hse()
+{
+    SET_BIT(RCC->CR, RCC_CR_HSEON);
+}
+
+/**
+ * ask for a profile switch - applied by clock_apply_request() at a safe point
+ */
+void clock_request_profile(const clock_profile_id_t id)
+{
+    clock_requested = id;
+}
+
+/**
+ * apply a requested profile; a profile needing the crystal stays pending until
+ * the HSE is ready so that the caller never waits for the crystal start up
+ */
+void clock_apply_request()
+{
+    int32_t id = clock_requested;
+
+    if ((id < 0) || (id >= CLOCK_PROFILE_COUNT)) {
+        return;
+    }
+
+    if ((clock_profiles[id].source != CLOCK_SOURCE_HSI) && ((RCC->CR & RCC_CR_HSERDY_Msk) != RCC_CR_HSERDY)) {
+        SET_BIT(RCC->CR, RCC_CR_HSEON);
+        return;
+    }
+
+    clock_requested = -1;
+    if ((clock_profile_id_t)id != clock_info.id) {
+        clock_set_profile((clock_profile_id_t)id);
+    }
+}
+
+/**
+ * a dropped listener would silently run with a stale clock - a full table is a
+ * configuration error (blink seven short flashes, see CLOCK_LISTENERS_MAX)
+ */
+void clock_register_listener(const clock_listener_t listener)
+{
+    if (clock_listeners_count >= CLOCK_LISTENERS_MAX) {
+        trace_record(TRACE_FAULT, 7, clock_listeners_count);
+        trace_stop();
+        blink(7);
+    }
+    clock_listeners[clock_listeners_count++] = listener;
+}
+
+/**
+ * same as the listeners: a dropped check would let a driver run at a clock it
+ * cannot handle (blink seven short flashes, see CLOCK_CHECKS_MAX)
+ */
+void clock_register_check(const clock_check_t check)
+{
+    if (clock_checks_count >= CLOCK_CHECKS_MAX) {
+        trace_record(TRACE_FAULT, 7, clock_checks_count);
+        trace_stop();
+        blink(7);
+    }
+    clock_checks[clock_checks_count++] = check;
+}
+
+const clock_info_t *clock_get_info()
+{
+    return &clock_info;
+}
+
+/**
+ * core clock for the kernel (configCPU_CLOCK_HZ)
+ */
+uint32_t clock_hclk_hz()
+{
+    return clock_info.hclk_hz;
+}
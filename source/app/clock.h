@@ -0,0 +1,52 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include "clock_profile.h"
+
+/* maximum number of drivers notified on a clock change */
+#define CLOCK_LISTENERS_MAX     8
+
+/* maximum number of drivers asked before a clock change */
+#define CLOCK_CHECKS_MAX        4
+
+/* called after the clock changed (the new settings are already active) */
+typedef void (*clock_listener_t)(const clock_info_t *info);
+
+/* called before a profile switch with the new settings - returns 0 to reject it */
+typedef uint32_t (*clock_check_t)(const clock_info_t *info);
+
+clock_error_t clock_set_profile(const clock_profile_id_t id);
+void clock_restore();
+void clock_start_hse();
+void clock_request_profile(const clock_profile_id_t id);
+void clock_apply_request();
+void clock_register_listener(const clock_listener_t listener);
+void clock_register_check(const clock_check_t check);
+const clock_info_t *clock_get_info();
+uint32_t clock_hclk_hz();
@@ -0,0 +1,143 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "clock_profile.h"
+
+/*
+    Clock profiles and their validation. This file does not touch any register and
+    can be compiled on the host to check the table against the STM32F411 limits
+    (RM0383 / DS10314, VDD 2.7..3.6V).
+*/
+
+#define CLOCK_HSI_HZ            16000000
+#define CLOCK_HSE_HZ            25000000
+
+const clock_profile_t clock_profiles[CLOCK_PROFILE_COUNT] = {
+    /*                            name           source              M   N    P  Q  AHB APB1 APB2 VOS */
+    [CLOCK_PROFILE_PERFORMANCE] = { "perf",      CLOCK_SOURCE_PLL,  25, 192, 2, 4,  1,  2,   2,   1 },
+    [CLOCK_PROFILE_BALANCED]    = { "balanced",  CLOCK_SOURCE_PLL,  25, 192, 4, 4,  1,  1,   1,   3 },
+    [CLOCK_PROFILE_LOW]         = { "low",       CLOCK_SOURCE_HSE,   0,   0, 0, 0,  1,  1,   1,   3 },
+    [CLOCK_PROFILE_HSI]         = { "hsi",       CLOCK_SOURCE_HSI,   0,   0, 0, 0,  1,  1,   1,   3 }
+};
+
+static int clock_is_bus_divider(const uint32_t div, const uint32_t max)
+{
+    for (uint32_t d = 1; d <= max; d <<= 1) {
+        if ((d == div) && (d != 32)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * check a profile and derive the bus, flash and ADC settings from it
+ */
+clock_error_t clock_profile_check(const clock_profile_t *profile, clock_info_t *info)
+{
+    uint32_t sysclk;
+
+    switch (profile->source) {
+        case CLOCK_SOURCE_HSI:
+            sysclk = CLOCK_HSI_HZ;
+            break;
+
+        case CLOCK_SOURCE_HSE:
+            sysclk = CLOCK_HSE_HZ;
+            break;
+
+        default: {
+            if ((profile->pllm < 2) || (profile->pllm > 63) ||
+                (profile->plln < 50) || (profile->plln > 432) ||
+                (profile->pllp < 2) || (profile->pllp > 8) || (profile->pllp & 1) ||
+                (profile->pllq < 2) || (profile->pllq > 15)) {
+                return CLOCK_ERROR_PLL_DIVIDER;
+            }
+
+            uint32_t vco_in = CLOCK_HSE_HZ / profile->pllm;
+            if ((vco_in < 1000000) || (vco_in > 2000000)) {
+                return CLOCK_ERROR_PLL_INPUT;
+            }
+
+            uint32_t vco_out = vco_in * profile->plln;
+            if ((vco_out < 100000000) || (vco_out > 432000000)) {
+                return CLOCK_ERROR_PLL_VCO;
+            }
+
+            sysclk = vco_out / profile->pllp;
+            break;
+        }
+    }
+
+    /* AHB: 1..512 without 32, APB: 1..16 */
+    if (!clock_is_bus_divider(profile->hpre, 512) ||
+        !clock_is_bus_divider(profile->ppre1, 16) ||
+        !clock_is_bus_divider(profile->ppre2, 16)) {
+        return CLOCK_ERROR_BUS_DIVIDER;
+    }
+
+    info->sysclk_hz = sysclk;
+    info->hclk_hz   = sysclk / profile->hpre;
+    info->pclk1_hz  = info->hclk_hz / profile->ppre1;
+    info->pclk2_hz  = info->hclk_hz / profile->ppre2;
+    info->tim_apb1_hz = (profile->ppre1 == 1) ? info->pclk1_hz : (info->pclk1_hz * 2);
+    info->tim_apb2_hz = (profile->ppre2 == 1) ? info->pclk2_hz : (info->pclk2_hz * 2);
+
+    /* maximum HCLK for the voltage scale */
+    static const uint32_t vos_max_hz[] = { 0, 100000000, 84000000, 64000000 };
+    if ((profile->vos < 1) || (profile->vos > 3) || (info->hclk_hz > vos_max_hz[profile->vos])) {
+        return CLOCK_ERROR_HCLK;
+    }
+    if (info->pclk1_hz > 50000000) {
+        return CLOCK_ERROR_PCLK1;
+    }
+    if (info->pclk2_hz > 100000000) {
+        return CLOCK_ERROR_PCLK2;
+    }
+
+    /* flash wait states for 2.7..3.6V */
+    static const uint32_t latency_max_hz[] = { 30000000, 64000000, 90000000, 100000000 };
+    info->flash_latency = 0;
+    while (info->hclk_hz > latency_max_hz[info->flash_latency]) {
+        info->flash_latency++;
+    }
+
+    /* ADC clock (max. 36MHz): the smallest prescaler not exceeding the target */
+    info->adc_prescaler = 0;
+    for (uint32_t pre = 2; pre <= 8; pre += 2) {
+        if ((info->pclk2_hz / pre) <= CLOCK_ADC_TARGET_HZ) {
+            info->adc_prescaler = pre;
+            break;
+        }
+    }
+    if (info->adc_prescaler == 0) {
+        return CLOCK_ERROR_ADC;
+    }
+    info->adc_hz = info->pclk2_hz / info->adc_prescaler;
+
+    return CLOCK_OK;
+}
@@ -0,0 +1,116 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include <stdint.h>
+
+/* system clock source */
+typedef enum clock_source_t {
+    CLOCK_SOURCE_HSI,           /* 16MHz internal RC */
+    CLOCK_SOURCE_HSE,           /* 25MHz crystal */
+    CLOCK_SOURCE_PLL            /* PLL fed by the HSE */
+} clock_source_t;
+
+/* available performance profiles */
+typedef enum clock_profile_id_t {
+    CLOCK_PROFILE_PERFORMANCE,  /* 96MHz, full rate capture */
+    CLOCK_PROFILE_BALANCED,     /* 48MHz, same ADC clock at a lower core voltage */
+    CLOCK_PROFILE_LOW,          /* 25MHz HSE, no PLL */
+    CLOCK_PROFILE_HSI,          /* 16MHz HSI, no crystal needed */
+    CLOCK_PROFILE_COUNT
+} clock_profile_id_t;
+
+/* a clock configuration as plain divider values */
+typedef struct clock_profile_t {
+    const char *name;
+    clock_source_t source;
+    uint32_t pllm;
+    uint32_t plln;
+    uint32_t pllp;
+    uint32_t pllq;
+    uint32_t hpre;              /* AHB divider: 1, 2, 4, ... 512 */
+    uint32_t ppre1;             /* APB1 divider: 1, 2, 4, 8, 16 */
+    uint32_t ppre2;             /* APB2 divider: 1, 2, 4, 8, 16 */
+    uint32_t vos;               /* regulator voltage scale 1, 2 or 3 */
+} clock_profile_t;
+
+/* everything the drivers need to know about a clock configuration */
+typedef struct clock_info_t {
+    clock_profile_id_t id;
+    uint32_t sysclk_hz;
+    uint32_t hclk_hz;
+    uint32_t pclk1_hz;
+    uint32_t pclk2_hz;
+    uint32_t tim_apb1_hz;       /* timer clock on APB1 (x2 if APB1 is divided) */
+    uint32_t tim_apb2_hz;       /* timer clock on APB2 (x2 if APB2 is divided) */
+    uint32_t flash_latency;     /* wait states */
+    uint32_t adc_prescaler;     /* 2, 4, 6 or 8 */
+    uint32_t adc_hz;
+} clock_info_t;
+
+/* what clock_profile_check derives from the HSI profile: the state of the clock
+   module until the first profile switch (checked by the host test) */
+#define CLOCK_INFO_HSI                                                                  \
+    {                                                                                   \
+        .id             = CLOCK_PROFILE_HSI,                                            \
+        .sysclk_hz      = 16000000,                                                     \
+        .hclk_hz        = 16000000,                                                     \
+        .pclk1_hz       = 16000000,                                                     \
+        .pclk2_hz       = 16000000,                                                     \
+        .tim_apb1_hz    = 16000000,                                                     \
+        .tim_apb2_hz    = 16000000,                                                     \
+        .flash_latency  = 0,                                                            \
+        .adc_prescaler  = 4,                                                            \
+        .adc_hz         = 4000000                                                       \
+    }
+
+/* validation results */
+typedef enum clock_error_t {
+    CLOCK_OK,
+    CLOCK_ERROR_PLL_INPUT,      /* VCO input outside 1..2MHz */
+    CLOCK_ERROR_PLL_VCO,        /* VCO output outside 100..432MHz */
+    CLOCK_ERROR_PLL_DIVIDER,    /* M, N, P or Q out of range */
+    CLOCK_ERROR_BUS_DIVIDER,    /* not a valid AHB/APB divider */
+    CLOCK_ERROR_HCLK,           /* HCLK too high for the voltage scale */
+    CLOCK_ERROR_PCLK1,          /* APB1 above 50MHz */
+    CLOCK_ERROR_PCLK2,          /* APB2 above 100MHz */
+    CLOCK_ERROR_ADC,            /* no ADC prescaler gives a valid ADC clock */
+    CLOCK_ERROR_PROFILE,        /* unknown profile */
+    CLOCK_ERROR_TIMEOUT,        /* an oscillator or the PLL did not get ready */
+    CLOCK_ERROR_REJECTED        /* a driver cannot run at the clock of the profile */
+} clock_error_t;
+
+/* target ADC clock - the prescaler is chosen to get as close as possible without exceeding it */
+#define CLOCK_ADC_TARGET_HZ     6000000
+
+/* slowest ADC clock of the profiles (HSI: 16MHz / 4) - checked by the host test */
+#define CLOCK_ADC_MIN_HZ        4000000
+
+extern const clock_profile_t clock_profiles[CLOCK_PROFILE_COUNT];
+
+clock_error_t clock_profile_check(const clock_profile_t *profile, clock_info_t *info);
@@ -0,0 +1,163 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmd.h"
+
+/*
+    Parser of the console protocol (no I/O - usable on the host as well).
+
+    set block=2000 burst=2 period=500 channel=9 smp=144
+*/
+
+typedef struct cmd_name_t {
+    const char *name;
+    cmd_id_t id;
+} cmd_name_t;
+
+static const cmd_name_t cmd_names[] = {
+    { "status",     CMD_STATUS },
+    { "stop",       CMD_STOP },
+    { "start",      CMD_START },
+    { "set",        CMD_SET },
+    { "defaults",   CMD_DEFAULTS },
+    { "trace",      CMD_TRACE },
+    { "bus",        CMD_BUS },
+    { "view",       CMD_VIEW },
+    { "help",       CMD_HELP }
+};
+
+/* keys of set and the configured fields */
+typedef struct cmd_key_t {
+    const char *name;
+    size_t offset;
+} cmd_key_t;
+
+static const cmd_key_t cmd_keys[] = {
+    { "block",      offsetof(acq_config_t, block_size) },
+    { "burst",      offsetof(acq_config_t, burst_blocks) },
+    { "period",     offsetof(acq_config_t, period_ms) },
+    { "channel",    offsetof(acq_config_t, channel) },
+    { "smp",        offsetof(acq_config_t, sample_cycles) }
+};
+
+#define CMD_COUNT(a)    (sizeof(a) / sizeof((a)[0]))
+#define CMD_DELIMITERS  " \t\r\n"
+
+static cmd_error_t cmd_parse_pair(char *pair, acq_config_t *config)
+{
+    char *value = strchr(pair, '=');
+    if ((value == NULL) || (value == pair) || (value[1] == '\0')) {
+        return CMD_ERROR_SYNTAX;
+    }
+    *value++ = '\0';
+
+    for (size_t i = 0; i < CMD_COUNT(cmd_keys); i++) {
+        if (strcmp(pair, cmd_keys[i].name) == 0) {
+            char *end;
+            unsigned long number = strtoul(value, &end, 10);
+            /* decimal, max. 9 digits (fits in 32 bits) */
+            if ((*end != '\0') || (*value < '0') || (*value > '9') || ((end - value) > 9)) {
+                return CMD_ERROR_VALUE;
+            }
+            *(uint32_t *)((char *)config + cmd_keys[i].offset) = (uint32_t)number;
+            return CMD_OK;
+        }
+    }
+    return CMD_ERROR_KEY;
+}
+
+/**
+ * parse one line (modified in place); a set is applied to the given configuration
+ * only if the whole line is valid
+ */
+cmd_error_t cmd_parse(char *line, cmd_id_t *id, acq_config_t *config)
+{
+    char *token = strtok(line, CMD_DELIMITERS);
+
+    *id = CMD_NONE;
+    if (token == NULL) {
+        return CMD_OK;
+    }
+
+    size_t i = 0;
+    while ((i < CMD_COUNT(cmd_names)) && (strcmp(token, cmd_names[i].name) != 0)) {
+        i++;
+    }
+    if (i == CMD_COUNT(cmd_names)) {
+        return CMD_ERROR_COMMAND;
+    }
+    *id = cmd_names[i].id;
+
+    if (*id != CMD_SET) {
+        return (strtok(NULL, CMD_DELIMITERS) == NULL) ? CMD_OK : CMD_ERROR_SYNTAX;
+    }
+
+    acq_config_t changed = *config;
+    uint32_t pairs = 0;
+    while ((token = strtok(NULL, CMD_DELIMITERS)) != NULL) {
+        cmd_error_t error = cmd_parse_pair(token, &changed);
+        if (error != CMD_OK) {
+            return error;
+        }
+        pairs++;
+    }
+    if (pairs == 0) {
+        return CMD_ERROR_SYNTAX;
+    }
+
+    *config = changed;
+    return CMD_OK;
+}
+
+const char *cmd_error_str(const cmd_error_t error)
+{
+    switch (error) {
+        case CMD_OK:            return "ok";
+        case CMD_ERROR_COMMAND: return "unknown command";
+        case CMD_ERROR_KEY:     return "unknown key";
+        case CMD_ERROR_VALUE:   return "bad value";
+        case CMD_ERROR_SYNTAX:  return "syntax";
+    }
+    return "?";
+}
+
+const char *cmd_acq_error_str(const acq_error_t error)
+{
+    switch (error) {
+        case ACQ_OK:                return "ok";
+        case ACQ_ERROR_BLOCK_SIZE:  return "block: multiple of 8, max. half of the pool";
+        case ACQ_ERROR_BURST:       return "burst: at least one block";
+        case ACQ_ERROR_PERIOD:      return "period: min. 10 ms";
+        case ACQ_ERROR_CHANNEL:     return "channel: 8 or 9";
+        case ACQ_ERROR_SAMPLE_TIME: return "smp: 3, 15, 28, 56, 84, 112, 144 or 480";
+        case ACQ_ERROR_RATE:        return "rate: the burst does not fit in the period";
+    }
+    return "?";
+}
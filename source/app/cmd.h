@@ -0,0 +1,59 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include "acq.h"
+
+/* max. length of a command line (without the terminator) */
+#define CMD_LINE_MAX    63
+
+/* commands of the console protocol (one line each, answered by "ok ..." or "err ...") */
+typedef enum cmd_id_t {
+    CMD_NONE,                   /* empty line */
+    CMD_STATUS,                 /* status                       - configuration and throughput */
+    CMD_STOP,                   /* stop                         - park the sampler */
+    CMD_START,                  /* start                        - resume the sampling */
+    CMD_SET,                    /* set key=value [key=value...] - change the configuration atomically */
+    CMD_DEFAULTS,               /* defaults                     - back to the build configuration */
+    CMD_TRACE,                  /* trace                        - dump the event trace over the ITM */
+    CMD_BUS,                    /* bus                          - measurement bus and subscriber counters */
+    CMD_VIEW,                   /* view                         - toggle the display between text and graph */
+    CMD_HELP                    /* help */
+} cmd_id_t;
+
+typedef enum cmd_error_t {
+    CMD_OK,
+    CMD_ERROR_COMMAND,          /* unknown command */
+    CMD_ERROR_KEY,              /* unknown key in set */
+    CMD_ERROR_VALUE,            /* not a decimal number */
+    CMD_ERROR_SYNTAX            /* missing key=value / extra arguments */
+} cmd_error_t;
+
+cmd_error_t cmd_parse(char *line, cmd_id_t *id, acq_config_t *config);
+const char *cmd_error_str(const cmd_error_t error);
+const char *cmd_acq_error_str(const acq_error_t error);
@@ -0,0 +1,200 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "queue.h"
+#include "printf.h"
+#include "clock.h"
+#include "uart.h"
+#include "dma.h"
+#include "acq.h"
+#include "cmd.h"
+#include "trace.h"
+#include "bus.h"
+#include "lcd.h"
+#include "console.h"
+
+/* a few periods for the sampler to reach the safe point */
+#define CONSOLE_APPLY_TIMEOUT_MS(period)    (2 * (period) + 100)
+
+/* response buffer: the longest line is the bus line with all the subscribers */
+#define CONSOLE_TXT_SIZE                    320
+#define CONSOLE_INT_MAX                     11  /* "-2147483648" */
+_Static_assert((sizeof("ok published= no_slot=") - 1 + 2 * CONSOLE_INT_MAX
+    + BUS_SUBSCRIBERS * (sizeof(" =///") - 1 + BUS_NAME_MAX + 4 * CONSOLE_INT_MAX)
+    + sizeof("\r\n")) <= CONSOLE_TXT_SIZE, "CONSOLE_TXT_SIZE too small for the bus line (BUS_SUBSCRIBERS)");
+
+/**
+ * bus counters: published=n no_slot=n <subscriber>=received/dropped/lag/max lag ...
+ */
+static void console_bus(char *txt)
+{
+    char *end = txt + sprintf(txt, "ok published=%d no_slot=%d", (int)bus_stats.published, (int)bus_stats.no_slot);
+
+    for (uint32_t i = 0; i < bus_subscriber_count(); i++) {
+        const bus_subscriber_t *subscriber = bus_subscriber(i);
+        end += sprintf(end, " %s=%d/%d/%d/%d", subscriber->name, (int)subscriber->received, (int)subscriber->dropped,
+            (int)subscriber->lag, (int)subscriber->lag_max);
+    }
+    sprintf(end, "\r\n");
+    uart_write_str(txt);
+}
+
+static void console_status(char *txt)
+{
+    acq_config_t config;
+    dma_get_config(&config);
+
+    sprintf(txt, "ok run=%d block=%d burst=%d period=%d channel=%d smp=%d rate=%d throughput=%d dropped=%d lost=%d fifo=%d skipped=%d rx=%d ore=%d\r\n",
+        (int)dma_is_running(), (int)config.block_size, (int)config.burst_blocks, (int)config.period_ms,
+        (int)config.channel, (int)config.sample_cycles, (int)acq_sample_rate(&config, clock_get_info()->adc_hz),
+        (int)acq_throughput(&config), (int)dma_dropped_blocks, (int)dma_lost_blocks, (int)dma_fifo_errors, (int)dma_skipped_windows,
+        (int)uart_rx_dropped, (int)uart_rx_overruns);
+    uart_write_str(txt);
+}
+
+/**
+ * validate and hand over a configuration; answer with the status once it is active
+ */
+static void console_configure(char *txt, const acq_config_t *config)
+{
+    acq_error_t error = acq_config_check(config, clock_get_info()->adc_hz);
+    if (error != ACQ_OK) {
+        sprintf(txt, "err %s\r\n", cmd_acq_error_str(error));
+        uart_write_str(txt);
+        return;
+    }
+
+    uint32_t generation = dma_config_generation();
+    TickType_t start = xTaskGetTickCount();
+    acq_config_t active;
+    dma_get_config(&active);
+
+    dma_request_config(config);
+    while (dma_config_generation() == generation) {
+        if ((xTaskGetTickCount() - start) > (CONSOLE_APPLY_TIMEOUT_MS(active.period_ms) / portTICK_PERIOD_MS)) {
+            uart_write_str("err timeout\r\n");
+            return;
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    console_status(txt);
+}
+
+static void console_execute(char *line, char *txt)
+{
+    acq_config_t config;
+    cmd_id_t id;
+
+    dma_get_config(&config);
+    cmd_error_t error = cmd_parse(line, &id, &config);
+    if (error != CMD_OK) {
+        sprintf(txt, "err %s\r\n", cmd_error_str(error));
+        uart_write_str(txt);
+        return;
+    }
+
+    switch (id) {
+        case CMD_NONE:
+            break;
+        case CMD_STATUS:
+            console_status(txt);
+            break;
+        case CMD_STOP:
+            dma_stop();
+            console_status(txt);
+            break;
+        case CMD_START:
+            dma_start();
+            console_status(txt);
+            break;
+        case CMD_SET:
+            console_configure(txt, &config);
+            break;
+        case CMD_DEFAULTS:
+            console_configure(txt, &acq_default_config);
+            break;
+        case CMD_TRACE:
+            if (trace_dump_itm()) {
+                sprintf(txt, "ok events=%d\r\n", (int)((trace.head < TRACE_EVENTS) ? trace.head : TRACE_EVENTS));
+                uart_write_str(txt);
+            } else {
+                uart_write_str("err trace: ITM port 1 not enabled\r\n");
+            }
+            break;
+        case CMD_BUS:
+            console_bus(txt);
+            break;
+        case CMD_VIEW:
+            lcd_set_view((lcd_get_view() == LCD_VIEW_TEXT) ? LCD_VIEW_GRAPH : LCD_VIEW_TEXT);
+            uart_write_str((lcd_get_view() == LCD_VIEW_TEXT) ? "ok view=text\r\n" : "ok view=graph\r\n");
+            break;
+        case CMD_HELP:
+            uart_write_str("ok status | stop | start | defaults | trace | bus | view | set block=n burst=n period=ms channel=8|9 smp=cycles\r\n");
+            break;
+    }
+}
+
+void vTaskConsole(void *pvParameters)
+{
+    (void)pvParameters;
+
+    char line[CMD_LINE_MAX + 1];
+    char txt[CONSOLE_TXT_SIZE];
+    uint32_t length = 0;
+    uint32_t overflow = 0;
+
+    for (;;) {
+        char c;
+        if (xQueueReceive(uart_rx_queue, &c, CONSOLE_IDLE_MS / portTICK_PERIOD_MS) != pdPASS) {
+            /* nobody talks to us: the MCU may enter STOP again */
+            uart_release_wake();
+            continue;
+        }
+
+        if ((c != '\r') && (c != '\n')) {
+            if (length < CMD_LINE_MAX) {
+                line[length++] = c;
+            } else {
+                overflow = 1;
+            }
+            continue;
+        }
+
+        if (overflow) {
+            uart_write_str("err line too long\r\n");
+        } else if (length > 0) {
+            line[length] = '\0';
+            console_execute(line, txt);
+        }
+        length = 0;
+        overflow = 0;
+    }
+}
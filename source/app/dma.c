@@ -25,41 +25,124 @@
  |                                                                            |
  |___________________________________________________________________________*/
 
+#include <string.h>
 #include "stm32f4xx.h"
 #include "stm32rtos.h"
+#include "task.h"
 #include "queue.h"
-#include "lcd.h"
+#include "adc.h"
+#include "power.h"
+#include "clock.h"
+#include "system.h"
+#include "boot.h"
+#include "timebase.h"
+#include "flashlog.h"
+#include "meas.h"
+#include "acq.h"
+#include "trace.h"
+#include "bus.h"
 #include "dma.h"
 
 
-/* adc samples count to take for averaging */
-#define ADC_SAMPLES_COUNT  1000
+/* max. time for the stream to finish the current transfer when disabled */
+#define DMA_TIMEOUT_US     100
+
+/* a burst that did not end this long after its nominal duration is abandoned */
+#define DMA_BURST_MARGIN_MS 10
+
+/* FIFO mode: the 16 bit ADC samples are packed in pairs into 32 bit memory words and
+   written in INCR4 bursts (16 bytes = one full FIFO); 0 - direct mode, 16 bit writes */
+#define DMA_FIFO_MODE      1
 
 /* Queue used to communicate dma messages. */
 QueueHandle_t dma_queue = NULL;
 
+/* active configuration (changed only while the sampler is parked) and the one
+   requested by the console */
+static acq_config_t dma_config;
+static acq_derived_t dma_derived;
+static acq_config_t dma_pending_config;
+static volatile uint32_t dma_pending = 0;
+static volatile uint32_t dma_generation = 0;
+
+/* the sampler runs bursts (cleared by dma_stop) */
+static volatile uint32_t dma_running = 1;
+static TaskHandle_t dma_task = NULL;
+
 /* message counter */
 static volatile uint32_t mss_counter = 0;
 
-/* the memmory buffers for the DMA */
-static uint16_t dma_buffer0[ADC_SAMPLES_COUNT];
-static uint16_t dma_buffer1[ADC_SAMPLES_COUNT];
+/* blocks completed in the current burst */
+static volatile uint32_t burst_blocks = 0;
+
+/* index of the first sample of the next block (counts all the acquired samples) */
+static uint64_t sample_index = 0;
+
+/* blocks that did not fit in the dma queue / detected as missing by the task */
+volatile uint32_t dma_dropped_blocks = 0;
+volatile uint32_t dma_lost_blocks = 0;
+
+/* the stream did not finish the last transfer in time (burst skipped / request postponed) */
+volatile uint32_t dma_park_timeouts = 0;
+
+/* FIFO errors seen by the interupt */
+volatile uint32_t dma_fifo_errors = 0;
+
+/* windows not sampled because a flash erase (CPU stalled) was running */
+volatile uint32_t dma_skipped_windows = 0;
+
+/* pool for the memmory buffers of the DMA: two samples per word (the layout is the
+   same in direct mode); aligned so that no burst crosses a 1KB boundary (a block is a
+   whole number of 16 byte bursts so the second buffer stays aligned) */
+static uint32_t dma_pool[ACQ_POOL_SAMPLES / 2] __attribute__((aligned(16)));
+static uint32_t *dma_buffer0 = dma_pool;
+static uint32_t *dma_buffer1 = dma_pool;
+
+/**
+ * carve the two buffers of a block out of the pool (stream disabled)
+ */
+static void dma_configure(const acq_config_t *config)
+{
+    dma_config = *config;
+    acq_derive(config, portTICK_PERIOD_MS, &dma_derived);
+    dma_buffer0 = &dma_pool[0];
+    dma_buffer1 = &dma_pool[dma_derived.buffer_words];
+
+    DMA2_Stream0->M0AR = (uint32_t)dma_buffer0;
+    DMA2_Stream0->M1AR = (uint32_t)dma_buffer1;
+    DMA2_Stream0->NDTR = config->block_size;
+}
+
+/**
+ * a clock profile is refused if the active configuration (or the one waiting to be
+ * applied) cannot be sampled with its ADC clock
+ */
+static uint32_t dma_clock_check(const clock_info_t *info)
+{
+    uint32_t ok;
+
+    taskENTER_CRITICAL();
+    ok = (acq_config_check(&dma_config, info->adc_hz) == ACQ_OK) &&
+         (!dma_pending || (acq_config_check(&dma_pending_config, info->adc_hz) == ACQ_OK));
+    taskEXIT_CRITICAL();
+
+    return ok;
+}
 
 void dma_init()
 {
     /* make sure the DMA stream is disabled */
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_EN_Msk, 0);
-    do {
-    } while ((DMA2_Stream0->CR & DMA_SxCR_EN_Msk) != 0);
+    if (!system_wait(&DMA2_Stream0->CR, DMA_SxCR_EN_Msk, 0, DMA_TIMEOUT_US)) {
+        boot_fail(BOOT_FAIL_DMA);
+    }
 
     /* clear the interupt register */
     SET_BIT(DMA2->LIFCR, DMA_LIFCR_CFEIF0_Msk | DMA_LIFCR_CDMEIF0_Msk | DMA_LIFCR_CTEIF0_Msk | DMA_LIFCR_CHTIF0_Msk | DMA_LIFCR_CTCIF0_Msk);
 
     /* configure the pointers/data amount for DMA */
     DMA2_Stream0->PAR  = (uint32_t)&(ADC1->DR);
-    DMA2_Stream0->M0AR = (uint32_t)dma_buffer0;
-    DMA2_Stream0->M1AR = (uint32_t)dma_buffer1;
-    DMA2_Stream0->NDTR = ADC_SAMPLES_COUNT;
+    dma_configure(&acq_default_config);
 
     /* select the channel 0 for the stram 0 - ADC1*/
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_CHSEL_Msk, 0);
@@ -73,19 +156,58 @@ void dma_init()
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_PSIZE_Msk, DMA_SxCR_PSIZE_0);   // 16 bit
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_PINC_Msk,  0);                  // no increment
     
+#if DMA_FIFO_MODE
+    /* configure memory */
+    MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MSIZE_Msk, DMA_SxCR_MSIZE_1);   // 32 bit
+    MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MINC_Msk,  DMA_SxCR_MINC);      // increment
+    MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MBURST_Msk, DMA_SxCR_MBURST_0); // INCR4
+
+    /* FIFO: direct mode disabled, threshold full FIFO, error interupt */
+    MODIFY_REG(DMA2_Stream0->FCR, DMA_SxFCR_DMDIS_Msk, DMA_SxFCR_DMDIS);
+    MODIFY_REG(DMA2_Stream0->FCR, DMA_SxFCR_FTH_Msk, DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1);
+    MODIFY_REG(DMA2_Stream0->FCR, DMA_SxFCR_FEIE_Msk, DMA_SxFCR_FEIE);
+#else
     /* configure memory */
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MSIZE_Msk, DMA_SxCR_MSIZE_0);   // 16 bit
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MINC_Msk,  DMA_SxCR_MINC);      // increment
+    MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_MBURST_Msk, 0);                 // single
+
+    /* direct mode */
+    MODIFY_REG(DMA2_Stream0->FCR, DMA_SxFCR_DMDIS_Msk, 0);
+    MODIFY_REG(DMA2_Stream0->FCR, DMA_SxFCR_FEIE_Msk, 0);
+#endif
 
     /* enable interupt */
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_TCIE_Msk, DMA_SxCR_TCIE);
+
+    memset(dma_pool, 0, sizeof(dma_pool));
+
+    /* a later profile switch has to keep the configuration valid */
+    clock_register_check(dma_clock_check);
 }
 
-void dma_enable()
+/**
+ * rewind and start the stream; 0 - the stream is still busy (not started)
+ */
+uint32_t dma_enable()
 {
-    memset(dma_buffer0, 0, ADC_SAMPLES_COUNT);
-    memset(dma_buffer1, 0, ADC_SAMPLES_COUNT);
+    /* a parked stream needs to be rewound: wait for the disable to complete
+       (the stream finishes the current transfer) before touching the registers */
+    if (!system_wait(&DMA2_Stream0->CR, DMA_SxCR_EN_Msk, 0, DMA_TIMEOUT_US)) {
+        dma_park_timeouts++;
+        trace_mark(TRACE_MARK_DMA_TIMEOUT, dma_park_timeouts);
+        return 0;
+    }
+
+    /* clear the interupt register and start again with memmory pointer 0 */
+    SET_BIT(DMA2->LIFCR, DMA_LIFCR_CFEIF0_Msk | DMA_LIFCR_CDMEIF0_Msk | DMA_LIFCR_CTEIF0_Msk | DMA_LIFCR_CHTIF0_Msk | DMA_LIFCR_CTCIF0_Msk);
+    MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_CT_Msk,  0);
+    DMA2_Stream0->NDTR = dma_config.block_size;
+
+    burst_blocks = 0;
+    bus_raw_advance();
     MODIFY_REG(DMA2_Stream0->CR, DMA_SxCR_EN_Msk, DMA_SxCR_EN);
+    return 1;
 }
 
 void dma_disable()
@@ -95,47 +217,263 @@ void dma_disable()
 
 void dma_isr_handler()
 {
-    if (DMA2->LISR & DMA_LISR_TCIF0_Msk) {
+    /* FIFO error (overrun): the stream keeps running, the sample was lost */
+    if (DMA2->LISR & DMA_LISR_FEIF0_Msk) {
+        SET_BIT(DMA2->LIFCR, DMA_LIFCR_CFEIF0_Msk);
+        dma_fifo_errors++;
+    }
+
+    /* the stream is parked: a TC raised by the disable (the FIFO drained into the
+       other buffer) is not a block */
+    if ((DMA2->LISR & DMA_LISR_TCIF0_Msk) && (burst_blocks >= dma_config.burst_blocks)) {
+        SET_BIT(DMA2->LIFCR, DMA_LIFCR_CFEIF0_Msk | DMA_LIFCR_CDMEIF0_Msk | DMA_LIFCR_CTEIF0_Msk | DMA_LIFCR_CHTIF0_Msk | DMA_LIFCR_CTCIF0_Msk);
+    } else if (DMA2->LISR & DMA_LISR_TCIF0_Msk) {
         dma_event_t dma_event;
 
-        dma_event.length = ADC_SAMPLES_COUNT;
+        /* the time of the first sample is derived from the progress in the next
+           buffer so that the interupt latency does not skew the stamp:
+           t_first = t_now - (samples in next buffer + block length - 1) * period */
+        uint64_t now = timebase_now_us();
+        uint32_t ndtr = DMA2_Stream0->NDTR;
+        uint32_t samples_since = ((DMA2_Stream0->CR & DMA_SxCR_EN_Msk) && (ndtr != 0)) ? (dma_config.block_size - ndtr) : 0;
+        uint64_t age_q16 = (uint64_t)(samples_since + dma_config.block_size - 1) * adc_sample_period_q16();
+
+        dma_event.timestamp_us = now - (age_q16 >> 16);
+        dma_event.sample_index = sample_index;
+        dma_event.raw_epoch = bus_raw_advance();
+        sample_index += dma_config.block_size;
+
+        dma_event.length = dma_config.block_size;
         if (DMA2_Stream0->CR & DMA_SxCR_CT_Msk) {
             dma_event.buffer = dma_buffer0;
         } else {
             dma_event.buffer = dma_buffer1;
         }
 
+        /* end of the burst: power down the ADC and park the stream right away
+           so that the other buffer is not filled in vain */
+        burst_blocks++;
+        dma_event.last = (burst_blocks >= dma_config.burst_blocks);
+        if (dma_event.last) {
+            adc_disable();
+            dma_disable();
+        }
+
         /* clear the interupt register */
         SET_BIT(DMA2->LIFCR, DMA_LIFCR_CFEIF0_Msk | DMA_LIFCR_CDMEIF0_Msk | DMA_LIFCR_CTEIF0_Msk | DMA_LIFCR_CHTIF0_Msk | DMA_LIFCR_CTCIF0_Msk);
-        xQueueSendFromISR(dma_queue, &dma_event, (TickType_t) 0);
+        if (xQueueSendFromISR(dma_queue, &dma_event, (TickType_t) 0) != pdPASS) {
+            dma_dropped_blocks++;
+            trace_mark(TRACE_MARK_BLOCK_DROPPED, dma_dropped_blocks);
+        }
+    }
+}
+
+/**
+ * copy of the active configuration
+ */
+void dma_get_config(acq_config_t *config)
+{
+    taskENTER_CRITICAL();
+    *config = dma_config;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * request a new (validated) configuration - applied at the end of the current burst
+ */
+void dma_request_config(const acq_config_t *config)
+{
+    taskENTER_CRITICAL();
+    dma_pending_config = *config;
+    dma_pending = 1;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * incremented every time a requested configuration was applied
+ */
+uint32_t dma_config_generation()
+{
+    return dma_generation;
+}
+
+void dma_stop()
+{
+    dma_running = 0;
+}
+
+void dma_start()
+{
+    dma_running = 1;
+    if (dma_task != NULL) {
+        xTaskNotifyGive(dma_task);
+    }
+}
+
+uint32_t dma_is_running()
+{
+    return dma_running;
+}
+
+/**
+ * apply a requested configuration: the ADC is off and the stream is parked
+ */
+static void dma_apply_request()
+{
+    if (dma_pending) {
+        acq_config_t config;
+
+        /* the buffers can only move once the stream is parked - retry at the next safe point */
+        if (!system_wait(&DMA2_Stream0->CR, DMA_SxCR_EN_Msk, 0, DMA_TIMEOUT_US)) {
+            dma_park_timeouts++;
+            trace_mark(TRACE_MARK_DMA_TIMEOUT, dma_park_timeouts);
+            return;
+        }
+
+        taskENTER_CRITICAL();
+        config = dma_pending_config;
+        dma_pending = 0;
+        taskEXIT_CRITICAL();
+
+        dma_configure(&config);
+        adc_configure(&dma_config, &dma_derived);
+        trace_mark(TRACE_MARK_CONFIG, config.block_size);
+        dma_generation++;
+    }
+}
+
+/**
+ * ticks a burst may take: its samples at the current ADC clock plus a margin
+ */
+static TickType_t dma_burst_ticks(const uint32_t blocks)
+{
+    uint64_t us = ((uint64_t)blocks * dma_config.block_size * adc_sample_period_q16()) >> 16;
+
+    return (TickType_t)(((us / 1000) + DMA_BURST_MARGIN_MS) / portTICK_PERIOD_MS) + 1;
+}
+
+/**
+ * the burst did not end in time (its last block did not fit in the queue or never
+ * completed): park the stream, drop what the queue still holds and count the blocks
+ * not received as lost; returns the index of the next block
+ */
+static uint64_t dma_burst_timeout(const uint64_t expected_index)
+{
+    /* from here on a TC is not a block (see dma_isr_handler) */
+    taskENTER_CRITICAL();
+    burst_blocks = dma_config.burst_blocks;
+    taskEXIT_CRITICAL();
+
+    adc_disable();
+    dma_disable();
+    xQueueReset(dma_queue);
+
+    if (sample_index != expected_index) {
+        dma_lost_blocks += (uint32_t)((sample_index - expected_index) / dma_config.block_size);
+        trace_mark(TRACE_MARK_BLOCK_LOST, dma_lost_blocks);
     }
+    return sample_index;
 }
 
 void vTaskDma(void *pvParameters)
 {
     (void)pvParameters;
 
-    dma_enable();
-    adc_enable();
+    dma_task = xTaskGetCurrentTaskHandle();
+
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    uint32_t duty_cycle = 0;
+    uint64_t expected_index = 0;
 
     for (;;) {
-        dma_event_t dma_event;
-        if (xQueueReceive(dma_queue, &dma_event, portMAX_DELAY) == pdPASS) {
-            lcd_event_t lcd_event;
+        TickType_t xBurstStart = xTaskGetTickCount();
+
+        /* sample a burst of blocks (the ADC and the DMA need the clocks - no STOP) */
+        power_stop_lock();
+        trace_mark(TRACE_MARK_BURST_START, (uint32_t)sample_index);
+
+        // a stream that did not park skips the window (counted in dma_park_timeouts)
+        uint32_t burst_done = 1;
+        if (dma_enable()) {
+            burst_done = 0;
+            adc_enable();
+            boot_mark(BOOT_PHASE_SAMPLING);
+        }
+
+        // the burst ends with the block flagged as the last one; if that one does not
+        // make it through the queue the burst ends at the timeout
+        TickType_t burst_ticks = dma_burst_ticks(dma_config.burst_blocks);
+        while (!burst_done) {
+            dma_event_t dma_event;
+            TickType_t waited = xTaskGetTickCount() - xBurstStart;
+            if ((waited >= burst_ticks) || (xQueueReceive(dma_queue, &dma_event, burst_ticks - waited) != pdPASS)) {
+                expected_index = dma_burst_timeout(expected_index);
+                break;
+            }
+            burst_done = dma_event.last;
 
-            // cumulate all values measured by the ADC in order to get the average
-            lcd_event.digital_value = 0;
-            for (uint16_t i = 0; i < dma_event.length; i++) {
-                lcd_event.digital_value += dma_event.buffer[i];
+            // a jump in the sample index means that blocks were lost on the way
+            if (dma_event.sample_index != expected_index) {
+                dma_lost_blocks += (uint32_t)((dma_event.sample_index - expected_index) / dma_event.length);
+                trace_mark(TRACE_MARK_BLOCK_LOST, dma_lost_blocks);
             }
+            expected_index = dma_event.sample_index + dma_event.length;
 
-            // calculate the voltage
-            lcd_event.voltage = (lcd_event.digital_value * 3.312f) / (4096.0f * dma_event.length);
-            lcd_event.mss_counter = mss_counter;
+            // publish the block once for all the consumers (display, log, ...)
+            bus_block_t *block = bus_claim();
+            if (block != NULL) {
+                // cumulate all values measured by the ADC in order to get the average
+                // (two samples per load)
+                block->digital_value = meas_sum_packed(dma_event.buffer, dma_event.length);
+
+                // calculate the voltage (scale of the block length, fixed point)
+                block->microvolts = meas_microvolts(block->digital_value, dma_derived.scale_q24);
+                block->sequence = mss_counter;
+                block->duty_cycle = duty_cycle;
+                block->length = dma_event.length;
+                block->timestamp_us = dma_event.timestamp_us;
+                block->sample_index = dma_event.sample_index;
+                block->raw = dma_event.buffer;
+                block->raw_epoch = dma_event.raw_epoch;
+                bus_publish(block);
+            }
             mss_counter++;
+            boot_mark(BOOT_PHASE_FIRST_READING);
+        }
+
+        // ADC and DMA are parked at this point; measure the active part of the window
+        power_stop_unlock();
+        duty_cycle = ((xTaskGetTickCount() - xBurstStart) * dma_derived.duty_q16) >> 16;
+        trace_mark(TRACE_MARK_BURST_END, duty_cycle);
+
+        // the sampler is parked: a good time for a requested clock profile switch
+        // (at boot: HSI -> PLL as soon as the crystal is ready) or a new configuration
+        clock_apply_request();
+        dma_apply_request();
+        boot_complete();
+
+        // a log sector erase runs here, before the next burst can start; it outlasts the
+        // idle part of the window so the windows it covered are skipped (same phase)
+        TickType_t period_ticks = dma_config.period_ms / portTICK_PERIOD_MS;
+        if (flashlog_sampler_parked()) {
+            while ((TickType_t)(xTaskGetTickCount() - xLastWakeTime) >= period_ticks) {
+                xLastWakeTime += period_ticks;
+                dma_skipped_windows++;
+            }
+            trace_mark(TRACE_MARK_WINDOW_SKIPPED, dma_skipped_windows);
+        }
+
+        // sleep until the next window (the idle task is free to enter a low power mode)
+        vTaskDelayUntil(&xLastWakeTime, period_ticks);
 
-            // send the measurement to the display task
-            xQueueSendToBack(lcd_queue, &lcd_event, (TickType_t) 0);
+        // stopped by the console: stay parked (still serving the requests) until started
+        while (!dma_running) {
+            ulTaskNotifyTake(pdTRUE, dma_config.period_ms / portTICK_PERIOD_MS);
+            clock_apply_request();
+            dma_apply_request();
+            flashlog_sampler_parked();
+            duty_cycle = 0;
+            xLastWakeTime = xTaskGetTickCount();
         }
     }
 }
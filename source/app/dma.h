@@ -27,15 +27,32 @@
 
 #pragma once
 
+#include "acq.h"
+
 typedef struct dma_event_t {
-    uint16_t *buffer;
-    uint16_t length;
+    uint32_t *buffer;           /* packed samples: sample 2n in the low, 2n+1 in the high half word */
+    uint16_t length;            /* number of samples */
+    uint64_t timestamp_us;      /* time base value at the first sample */
+    uint64_t sample_index;      /* index of the first sample since the start */
+    uint32_t raw_epoch;         /* bus epoch while the buffer stays untouched */
+    uint8_t last;               /* the burst ends with this block (stream parked) */
 } dma_event_t;
 
 extern QueueHandle_t dma_queue;
+extern volatile uint32_t dma_fifo_errors;
+extern volatile uint32_t dma_dropped_blocks;
+extern volatile uint32_t dma_lost_blocks;
+extern volatile uint32_t dma_park_timeouts;
+extern volatile uint32_t dma_skipped_windows;
 
 void dma_init();
-void dma_enable();
+uint32_t dma_enable();
 void dma_disable();
 void dma_isr_handler();
+void dma_get_config(acq_config_t *config);
+void dma_request_config(const acq_config_t *config);
+uint32_t dma_config_generation();
+void dma_stop();
+void dma_start();
+uint32_t dma_is_running();
 void vTaskDma(void *pvParameters);
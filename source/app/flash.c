@@ -0,0 +1,170 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "clock.h"
+#include "timebase.h"
+#include "flash.h"
+
+/*
+    Internal flash of the STM32F411CE (512KB):
+        sector 0..3:  16KB  0x08000000
+        sector 4:     64KB  0x08010000
+        sector 5..7: 128KB  0x08020000
+    Programming is done with 32 bit parallelism (VDD 2.7..3.6V). The CPU stalls when
+    fetching from the flash during an operation, so the operations run from RAM
+    (.RamFunc, copied with .data - see app.ld) and only touch registers there.
+    An erase (up to 2s for a 128KB sector) runs with the interrupts masked: no
+    handler, kernel code included, can fetch from the busy flash half way. The ticks
+    missed meanwhile are handed back to the kernel afterwards. The log has its
+    sectors erased by the sampler task while parked, so no burst is cut by one.
+*/
+
+/* RAM resident, never inlined into a flash caller (global so that app.ld can check it) */
+#define FLASH_RAMFUNC               __attribute__((section(".RamFunc"), noinline))
+
+#define FLASH_SECTOR_COUNT          8
+#define FLASH_TIMEOUT_PROGRAM_US    1000
+#define FLASH_TIMEOUT_ERASE_US      4000000
+
+#define FLASH_SR_ERRORS             (FLASH_SR_OPERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+static const uint32_t flash_sectors[FLASH_SECTOR_COUNT] = {
+    0x08000000, 0x08004000, 0x08008000, 0x0800C000, 0x08010000, 0x08020000, 0x08040000, 0x08060000
+};
+
+uint32_t flash_ram_erase(const uint32_t sector, const uint32_t timeout_cycles);
+uint32_t flash_ram_program(const uint32_t address, const uint32_t data, const uint32_t timeout_cycles);
+
+static inline __attribute__((always_inline)) void flash_unlock()
+{
+    if (FLASH->CR & FLASH_CR_LOCK_Msk) {
+        FLASH->KEYR = 0x45670123;
+        FLASH->KEYR = 0xCDEF89AB;
+    }
+    SET_BIT(FLASH->SR, FLASH_SR_EOP | FLASH_SR_ERRORS);
+    MODIFY_REG(FLASH->CR, FLASH_CR_PSIZE_Msk, FLASH_CR_PSIZE_1);
+}
+
+/**
+ * wait for the end of the operation (DWT cycles - no call into the flash) and lock
+ */
+static inline __attribute__((always_inline)) uint32_t flash_finish(const uint32_t timeout_cycles)
+{
+    const uint32_t start = DWT->CYCCNT;
+    uint32_t ok = 1;
+
+    while (FLASH->SR & FLASH_SR_BSY_Msk) {
+        if ((DWT->CYCCNT - start) > timeout_cycles) {
+            ok = 0;
+            break;
+        }
+    }
+    if (FLASH->SR & FLASH_SR_ERRORS) {
+        ok = 0;
+    }
+
+    CLEAR_BIT(FLASH->CR, FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_SNB_Msk);
+    SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+    return ok;
+}
+
+static uint32_t flash_timeout_cycles(const uint32_t timeout_us)
+{
+    return timeout_us * (clock_get_info()->hclk_hz / 1000000);
+}
+
+FLASH_RAMFUNC uint32_t flash_ram_erase(const uint32_t sector, const uint32_t timeout_cycles)
+{
+    flash_unlock();
+    MODIFY_REG(FLASH->CR, FLASH_CR_SNB_Msk, sector << FLASH_CR_SNB_Pos);
+    SET_BIT(FLASH->CR, FLASH_CR_SER);
+    SET_BIT(FLASH->CR, FLASH_CR_STRT);
+    uint32_t ok = flash_finish(timeout_cycles);
+
+    /* the data cache may hold the old content */
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_DCEN);
+    SET_BIT(FLASH->ACR, FLASH_ACR_DCRST);
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_DCRST);
+    SET_BIT(FLASH->ACR, FLASH_ACR_DCEN);
+
+    return ok;
+}
+
+FLASH_RAMFUNC uint32_t flash_ram_program(const uint32_t address, const uint32_t data, const uint32_t timeout_cycles)
+{
+    flash_unlock();
+    SET_BIT(FLASH->CR, FLASH_CR_PG);
+    *(volatile uint32_t *)address = data;
+    return flash_finish(timeout_cycles);
+}
+
+uint32_t flash_sector_address(const uint32_t sector)
+{
+    return flash_sectors[sector];
+}
+
+uint32_t flash_sector_size(const uint32_t sector)
+{
+    return (sector < 4) ? 0x4000 : ((sector == 4) ? 0x10000 : 0x20000);
+}
+
+/**
+ * erase a sector (blocking: up to 2s for a 128KB sector, interrupts masked) - returns
+ * 0 on error. Called from a task while the sampler is parked.
+ */
+uint32_t flash_erase_sector(const uint32_t sector)
+{
+    if (sector >= FLASH_SECTOR_COUNT) {
+        return 0;
+    }
+
+    const uint32_t timeout_cycles = flash_timeout_cycles(FLASH_TIMEOUT_ERASE_US);
+    const uint64_t start_us = timebase_now_us();
+
+    __disable_irq();
+    uint32_t ok = flash_ram_erase(sector, timeout_cycles);
+    __enable_irq();
+
+    /* the time base kept counting (TIM2); the kernel saw at most the pending tick */
+    uint32_t ticks = (uint32_t)((timebase_now_us() - start_us) / (1000 * portTICK_PERIOD_MS));
+    if (ticks > 1) {
+        xTaskCatchUpTicks(ticks - 1);
+    }
+
+    return ok;
+}
+
+/**
+ * program one word (address aligned to 4, location erased) - returns 0 on error
+ */
+uint32_t flash_program_word(const uint32_t address, const uint32_t data)
+{
+    return flash_ram_program(address, data, flash_timeout_cycles(FLASH_TIMEOUT_PROGRAM_US));
+}
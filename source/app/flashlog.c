@@ -0,0 +1,258 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "queue.h"
+#include "system.h"
+#include "trace.h"
+#include "bus.h"
+#include "flashlog.h"
+
+/* a full log queue holds its blocks in the bus slots; the display, the block in the
+   log task and the one being filled by the sampler need one more each */
+_Static_assert((FLASHLOG_DEPTH + 4) <= BUS_SLOTS, "BUS_SLOTS too small for the log queue (FLASHLOG_DEPTH)");
+
+/*
+    Append only log in a ring of flash sectors. Every sector starts with a header
+    holding a sequence number; the active sector is the valid one with the highest
+    sequence and the write position is the first empty slot in it. A record cut by a
+    power loss fails its crc and is skipped by the reader, the writer continues
+    after it.
+
+    The log task is a lossless subscriber of the measurement bus: it turns the blocks
+    into records and commits them in batches, one word at a time so that it can be
+    preempted between the words. Erasing a sector stalls the CPU for up to 2s: the
+    log task only requests it, the sampler task runs it at its park point (no burst
+    can start before the erase is done) and skips the windows it took. Nothing is
+    erased during the init (an empty log starts its first sector with the first
+    commit).
+*/
+
+/* every block, in order (a full queue shows up as a gap in the log) */
+static bus_subscriber_t *flashlog_bus = NULL;
+
+flashlog_stats_t flashlog_stats = {0};
+
+static flashlog_hw_control_t flashlog_hw;
+
+/* active sector (0..FLASHLOG_SECTOR_COUNT-1), its sequence and the write offset */
+static uint32_t active = 0;
+static uint32_t active_sequence = 0;
+static uint32_t write_offset = 0;
+
+/* erase requested by the log task (waiting for it), run by the sampler when parked */
+static TaskHandle_t erase_task = NULL;
+static volatile uint32_t erase_pending = 0;
+static volatile uint32_t erase_target = 0;
+static uint32_t erase_count = 0;
+
+static uint8_t flashlog_crc8(const uint8_t *data, const uint32_t length)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t flashlog_address(const uint32_t sector)
+{
+    return flashlog_hw.sector_address(FLASHLOG_SECTOR_FIRST + sector);
+}
+
+static uint32_t flashlog_size(const uint32_t sector)
+{
+    return flashlog_hw.sector_size(FLASHLOG_SECTOR_FIRST + sector);
+}
+
+static uint32_t flashlog_program(const uint32_t address, const uint32_t *words, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (!flashlog_hw.program_word(address + (i * 4), words[i])) {
+            flashlog_stats.errors++;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * have the sector erased by the sampler and write its header
+ */
+static void flashlog_start_sector(const uint32_t sector, const uint32_t sequence)
+{
+    erase_target = sector;
+    erase_pending = 1;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    flashlog_header_t header = {
+        .magic       = FLASHLOG_MAGIC,
+        .sequence    = sequence,
+        .erase_count = erase_count,
+        .reserved    = 0xFFFFFFFF
+    };
+
+    /* the magic goes last: a header cut by a power loss is not taken as valid */
+    const uint32_t *words = (const uint32_t *)&header;
+    flashlog_program(flashlog_address(sector) + 4, &words[1], (sizeof(header) / 4) - 1);
+    flashlog_program(flashlog_address(sector), &words[0], 1);
+
+    active = sector;
+    active_sequence = sequence;
+    write_offset = sizeof(flashlog_header_t);
+}
+
+/**
+ * find the active sector and the write position (after a reset or a power loss)
+ */
+void flashlog_init(flashlog_hw_control_t hw)
+{
+    uint32_t found = 0;
+
+    flashlog_hw = hw;
+    flashlog_bus = bus_subscribe("log", BUS_MODE_LOSSLESS, FLASHLOG_DEPTH);
+
+    /* no subscriber left or no heap for the queue (blink eight short flashes) */
+    if (flashlog_bus == NULL) {
+        trace_record(TRACE_FAULT, 8, 1);
+        trace_stop();
+        blink(8);
+    }
+
+    for (uint32_t sector = 0; sector < FLASHLOG_SECTOR_COUNT; sector++) {
+        const flashlog_header_t *header = (const flashlog_header_t *)flashlog_address(sector);
+        if ((header->magic == FLASHLOG_MAGIC) && (!found || (header->sequence > active_sequence))) {
+            active = sector;
+            active_sequence = header->sequence;
+            found = 1;
+        }
+    }
+
+    if (!found) {
+        /* empty log: the last sector counts as full so that the first commit starts
+           sector 0 with sequence 1 (the erase waits for the sampler to park) */
+        active = FLASHLOG_SECTOR_COUNT - 1;
+        active_sequence = 0;
+        write_offset = flashlog_size(active);
+        return;
+    }
+
+    /* first empty slot: a slot is used as soon as one word is programmed */
+    uint32_t base = flashlog_address(active);
+    uint32_t size = flashlog_size(active);
+    for (write_offset = size; write_offset > sizeof(flashlog_header_t); write_offset -= sizeof(flashlog_record_t)) {
+        const uint32_t *slot = (const uint32_t *)(base + write_offset - sizeof(flashlog_record_t));
+        if ((slot[0] & slot[1] & slot[2] & slot[3]) != 0xFFFFFFFF) {
+            break;
+        }
+    }
+}
+
+/**
+ * called by the sampler task when the ADC and the DMA are parked: runs a requested
+ * erase (the CPU stalls for up to FLASHLOG_ERASE_MS); returns 1 if it did
+ */
+uint32_t flashlog_sampler_parked()
+{
+    if (!erase_pending || (erase_task == NULL)) {
+        return 0;
+    }
+
+    /* the erase count survives in the header of the sector */
+    const flashlog_header_t *old = (const flashlog_header_t *)flashlog_address(erase_target);
+    erase_count = ((old->magic == FLASHLOG_MAGIC) ? old->erase_count : 0) + 1;
+
+    if (!flashlog_hw.erase_sector(FLASHLOG_SECTOR_FIRST + erase_target)) {
+        flashlog_stats.errors++;
+    }
+    flashlog_stats.erases++;
+
+    erase_pending = 0;
+    xTaskNotifyGive(erase_task);
+    return 1;
+}
+
+static void flashlog_commit(const flashlog_record_t *records, const uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if ((write_offset + sizeof(flashlog_record_t)) > flashlog_size(active)) {
+            /* sector full: move to the next one (the oldest) */
+            flashlog_start_sector((active + 1) % FLASHLOG_SECTOR_COUNT, active_sequence + 1);
+        }
+
+        if (flashlog_program(flashlog_address(active) + write_offset, (const uint32_t *)&records[i], sizeof(flashlog_record_t) / 4)) {
+            flashlog_stats.records++;
+        }
+        write_offset += sizeof(flashlog_record_t);
+    }
+}
+
+void vTaskLog(void *pvParameters)
+{
+    (void)pvParameters;
+
+    flashlog_record_t batch[FLASHLOG_BATCH];
+    uint32_t count = 0;
+    uint8_t flags = FLASHLOG_FLAG_BOOT;
+    uint64_t expected_index = 0;
+
+    erase_task = xTaskGetCurrentTaskHandle();
+
+    for (;;) {
+        const bus_block_t *block = bus_receive(flashlog_bus, portMAX_DELAY);
+        if (block != NULL) {
+            flashlog_record_t *record = &batch[count];
+
+            /* blocks lost by the sampler or dropped by the bus leave a hole in the samples */
+            if (block->sample_index != expected_index) {
+                flags |= FLASHLOG_FLAG_GAP;
+            }
+            expected_index = block->sample_index + block->length;
+
+            record->sequence = block->sequence;
+            record->timestamp_ms = (uint32_t)(block->timestamp_us / 1000);
+            record->digital_value = block->digital_value;
+            record->length = block->length;
+            record->flags = flags;
+            record->crc = flashlog_crc8((const uint8_t *)record, sizeof(flashlog_record_t) - 1);
+            bus_release(block);
+            flags = 0;
+
+            count++;
+            if (count == FLASHLOG_BATCH) {
+                flashlog_commit(batch, count);
+                count = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include "acq.h"
+
+/* log area: the last two 128KB sectors (0x08040000 - 0x0807FFFF), kept out of the
+   image by app.ld */
+#define FLASHLOG_SECTOR_FIRST   6
+#define FLASHLOG_SECTOR_COUNT   2
+
+/* records committed at once (256 bytes) */
+#define FLASHLOG_BATCH          16
+
+/* worst case erase of a 128KB sector (x32 parallelism) */
+#define FLASHLOG_ERASE_MS       2000
+
+/* bus queue of the log: a batch plus the blocks of the build configuration for as
+   many windows as an erase takes - the windows during the erase are skipped, the
+   margin lets the log task fall behind by that much (writing the new header, a
+   display update) without a gap */
+#define FLASHLOG_DEPTH          (FLASHLOG_BATCH + ((((FLASHLOG_ERASE_MS + ACQ_PERIOD_MS - 1) / ACQ_PERIOD_MS) + 1) * ACQ_BURST_BLOCKS))
+
+/* record flags */
+#define FLASHLOG_FLAG_BOOT      0x01    /* first record after a reset */
+#define FLASHLOG_FLAG_GAP       0x02    /* blocks were lost before this one */
+
+/* one record per block (16 bytes); all 0xFF is an empty slot */
+typedef struct flashlog_record_t {
+    uint32_t sequence;          /* block counter */
+    uint32_t timestamp_ms;      /* time of the first sample since the reset */
+    uint32_t digital_value;     /* sum of the samples */
+    uint16_t length;            /* number of samples */
+    uint8_t  flags;
+    uint8_t  crc;               /* crc8 (0x07) over the first 15 bytes */
+} flashlog_record_t;
+
+/* the sector header is a record sized slot at the start of every sector */
+typedef struct flashlog_header_t {
+    uint32_t magic;
+    uint32_t sequence;          /* increases with every sector change */
+    uint32_t erase_count;
+    uint32_t reserved;
+} flashlog_header_t;
+
+#define FLASHLOG_MAGIC          0x474F4C46  /* "FLOG" */
+
+/* flash access - allows to run the log on another (i.e. simulated) memory */
+typedef struct flashlog_hw_control_t {
+    uint32_t (*sector_address)(const uint32_t sector);
+    uint32_t (*sector_size)(const uint32_t sector);
+    uint32_t (*erase_sector)(const uint32_t sector);
+    uint32_t (*program_word)(const uint32_t address, const uint32_t data);
+} flashlog_hw_control_t;
+
+/* statistics */
+typedef struct flashlog_stats_t {
+    uint32_t records;           /* committed records */
+    uint32_t errors;            /* failed program/erase operations */
+    uint32_t erases;
+} flashlog_stats_t;
+
+extern flashlog_stats_t flashlog_stats;
+
+void flashlog_init(flashlog_hw_control_t hw);
+uint32_t flashlog_sampler_parked();
+void vTaskLog(void *pvParameters);
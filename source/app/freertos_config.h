@@ -0,0 +1,62 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/*
+    Application overrides of the FreeRTOS configuration. The file is passed as a
+    prefix header to the application and to the freertos product (see app.qbs and
+    the Makefile), so the kernel and the application are built with the same values
+    without touching the FreeRTOSConfig.h of the freertos submodule.
+*/
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+
+/* stop the tick while the idle task runs (burst sampling leaves most of the window idle);
+   the idle time is spent in SLEEP or STOP by the power module */
+void power_sleep(uint32_t expected_idle_ticks);
+
+#undef  configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE                 2
+
+#undef  portSUPPRESS_TICKS_AND_SLEEP
+#define portSUPPRESS_TICKS_AND_SLEEP(x)         power_sleep(x)
+
+/* the core clock changes at run time (HSI at start up, then the clock profiles) -
+   the scheduler starts the SysTick with the active HCLK */
+uint32_t clock_hclk_hz();
+
+#undef  configCPU_CLOCK_HZ
+#define configCPU_CLOCK_HZ                      (clock_hclk_hz())
+
+/* scheduler and queue events for the trace recorder */
+#include "trace_hooks.h"
+
+#endif
@@ -28,18 +28,67 @@
 #include "stm32f4xx.h"
 #include "gpio.h"
 
+/* JTAG pins released (JTDI, NJTRST, JTDO as inputs) */
+static const gpio_pinset_t gpio_jtag_off[] = {
+    GPIO_PINSET_MODE(GPIOA, GPIO_ODR_OD15, GPIO_MODE_INPUT),
+    GPIO_PINSET_MODE(GPIOB, GPIO_ODR_OD3 | GPIO_ODR_OD4, GPIO_MODE_INPUT)
+};
+
+/* blue LED on PC13 */
+static const gpio_pinset_t gpio_led =
+    GPIO_PINSET(GPIOC, GPIO_ODR_OD13, GPIO_MODE_OUTPUT, GPIO_OTYPE_PUSH_PULL, GPIO_SPEED_LOW, GPIO_PULL_NONE);
+
+/* LCD data bus PA0..PA7 */
+#define GPIO_LCD_DATA_PINS  0x00FFU
+static const gpio_pinset_t gpio_lcd_data_out =
+    GPIO_PINSET(GPIOA, GPIO_LCD_DATA_PINS, GPIO_MODE_OUTPUT, GPIO_OTYPE_PUSH_PULL, GPIO_SPEED_LOW, GPIO_PULL_NONE);
+static const gpio_pinset_t gpio_lcd_data_dir_out =
+    GPIO_PINSET_MODE(GPIOA, GPIO_LCD_DATA_PINS, GPIO_MODE_OUTPUT);
+static const gpio_pinset_t gpio_lcd_data_dir_in =
+    GPIO_PINSET_MODE(GPIOA, GPIO_LCD_DATA_PINS, GPIO_MODE_INPUT);
+
+/* LCD control: RS on PB8, E on PB9 */
+static const gpio_pinset_t gpio_lcd_control_out =
+    GPIO_PINSET(GPIOB, GPIO_ODR_OD8 | GPIO_ODR_OD9, GPIO_MODE_OUTPUT, GPIO_OTYPE_PUSH_PULL, GPIO_SPEED_LOW, GPIO_PULL_NONE);
+
+/**
+ * configure a pin set: one read-modify-write per register
+ */
+void gpio_apply(const gpio_pinset_t *set)
+{
+    if (set->moder_mask) {
+        MODIFY_REG(set->port->MODER, set->moder_mask, set->moder);
+    }
+    if (set->otyper_mask) {
+        MODIFY_REG(set->port->OTYPER, set->otyper_mask, set->otyper);
+    }
+    if (set->ospeedr_mask) {
+        MODIFY_REG(set->port->OSPEEDR, set->ospeedr_mask, set->ospeedr);
+    }
+    if (set->pupdr_mask) {
+        MODIFY_REG(set->port->PUPDR, set->pupdr_mask, set->pupdr);
+    }
+    if (set->afr_mask[0]) {
+        MODIFY_REG(set->port->AFR[0], set->afr_mask[0], set->afr[0]);
+    }
+    if (set->afr_mask[1]) {
+        MODIFY_REG(set->port->AFR[1], set->afr_mask[1], set->afr[1]);
+    }
+}
+
 void gpio_init()
 {
     /* disable JTAG */
-    MODIFY_REG(GPIOA->MODER,    GPIO_MODER_MODER15_Msk,     0);                         /* JTDI disabled */
-    MODIFY_REG(GPIOB->MODER,    GPIO_MODER_MODER4_Msk,      0);                         /* NJTRST disabled */
-    MODIFY_REG(GPIOB->MODER,    GPIO_MODER_MODER3_Msk,      0);                         /* JTDO disabled */
-    
+    gpio_apply(&gpio_jtag_off[0]);
+    gpio_apply(&gpio_jtag_off[1]);
+
     /* configure LED pin */
-    MODIFY_REG(GPIOC->MODER,    GPIO_MODER_MODER13_Msk,     GPIO_MODER_MODER13_0);      /* set the pin as output */
-    MODIFY_REG(GPIOC->OTYPER,   GPIO_OTYPER_OT13_Msk,       0);                         /* push pull */
-    MODIFY_REG(GPIOC->OSPEEDR,  GPIO_OSPEEDR_OSPEED13_Msk,  0);                         /* low speed */
-    MODIFY_REG(GPIOC->PUPDR,    GPIO_PUPDR_PUPD13_Msk,      0);                         /* no pull up, no pull down */
+    gpio_apply(&gpio_led);
+
+    /* output type, speed and pull of the LCD data bus - the bus turnaround only
+       changes the mode afterwards */
+    gpio_apply(&gpio_lcd_data_out);
+    gpio_apply(&gpio_lcd_data_dir_in);
 }
 
 void gpio_set_blue_led()
@@ -84,75 +133,15 @@ uint8_t gpio_data_rd()
 
 void gpio_config_data_out()
 {
-    /* set the pin as output */
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER0_Msk, GPIO_MODER_MODER0_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER1_Msk, GPIO_MODER_MODER1_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER2_Msk, GPIO_MODER_MODER2_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER3_Msk, GPIO_MODER_MODER3_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER4_Msk, GPIO_MODER_MODER4_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER5_Msk, GPIO_MODER_MODER5_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER6_Msk, GPIO_MODER_MODER6_0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER7_Msk, GPIO_MODER_MODER7_0);
-
-    /* push pull */
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT0_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT1_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT2_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT3_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT4_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT5_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT6_Msk, 0);
-    MODIFY_REG(GPIOA->OTYPER, GPIO_OTYPER_OT7_Msk, 0);
-
-    /* low speed */
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED0_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED1_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED2_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED3_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED4_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED5_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED6_Msk, 0);
-    MODIFY_REG(GPIOA->OSPEEDR, GPIO_OSPEEDR_OSPEED7_Msk, 0);
-
-    /* no pull up, no pull down */
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD0_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD1_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD2_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD3_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD4_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD5_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD6_Msk, 0);
-    MODIFY_REG(GPIOA->PUPDR, GPIO_PUPDR_PUPD7_Msk, 0);
+    gpio_apply(&gpio_lcd_data_dir_out);
 }
 
 void gpio_config_data_in()
 {
-    /* set the pin as input */
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER0_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER1_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER2_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER3_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER4_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER5_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER6_Msk, 0);
-    MODIFY_REG(GPIOA->MODER, GPIO_MODER_MODER7_Msk, 0);
+    gpio_apply(&gpio_lcd_data_dir_in);
 }
 
 void gpio_config_control_out()
 {
-    /* set the pin as output */
-    MODIFY_REG(GPIOB->MODER, GPIO_MODER_MODER8_Msk, GPIO_MODER_MODER8_0);
-    MODIFY_REG(GPIOB->MODER, GPIO_MODER_MODER9_Msk, GPIO_MODER_MODER9_0);
-
-    /* push pull */
-    MODIFY_REG(GPIOB->OTYPER, GPIO_OTYPER_OT8_Msk, 0);
-    MODIFY_REG(GPIOB->OTYPER, GPIO_OTYPER_OT9_Msk, 0);
-
-    /* low speed */
-    MODIFY_REG(GPIOB->OSPEEDR, GPIO_OSPEEDR_OSPEED8_Msk, 0);
-    MODIFY_REG(GPIOB->OSPEEDR, GPIO_OSPEEDR_OSPEED9_Msk, 0);
-
-    /* no pull up, no pull down */
-    MODIFY_REG(GPIOB->PUPDR, GPIO_PUPDR_PUPD8_Msk, 0);
-    MODIFY_REG(GPIOB->PUPDR, GPIO_PUPDR_PUPD9_Msk, 0);
+    gpio_apply(&gpio_lcd_control_out);
 }
@@ -27,6 +27,100 @@
  
 #pragma once
 
+#include "stm32f4xx.h"
+
+/* pin modes, output types, speeds and pulls (register field values) */
+#define GPIO_MODE_INPUT         0U
+#define GPIO_MODE_OUTPUT        1U
+#define GPIO_MODE_AF            2U
+#define GPIO_MODE_ANALOG        3U
+
+#define GPIO_OTYPE_PUSH_PULL    0U
+#define GPIO_OTYPE_OPEN_DRAIN   1U
+
+#define GPIO_SPEED_LOW          0U
+#define GPIO_SPEED_MEDIUM       1U
+#define GPIO_SPEED_FAST         2U
+#define GPIO_SPEED_HIGH         3U
+
+#define GPIO_PULL_NONE          0U
+#define GPIO_PULL_UP            1U
+#define GPIO_PULL_DOWN          2U
+
+/* spread a 16 bit pin mask to the 2 bit fields of MODER/OSPEEDR/PUPDR (constant expression) */
+#define GPIO_SPREAD2(pins) ( \
+    (((pins) & 0x0001U) << 0)  | (((pins) & 0x0002U) << 1)  | (((pins) & 0x0004U) << 2)  | (((pins) & 0x0008U) << 3)  | \
+    (((pins) & 0x0010U) << 4)  | (((pins) & 0x0020U) << 5)  | (((pins) & 0x0040U) << 6)  | (((pins) & 0x0080U) << 7)  | \
+    (((pins) & 0x0100U) << 8)  | (((pins) & 0x0200U) << 9)  | (((pins) & 0x0400U) << 10) | (((pins) & 0x0800U) << 11) | \
+    (((pins) & 0x1000U) << 12) | (((pins) & 0x2000U) << 13) | (((pins) & 0x4000U) << 14) | (((pins) & 0x8000U) << 15))
+
+/* spread the low 8 bits of a pin mask to the 4 bit fields of AFR[0]/AFR[1] (constant expression) */
+#define GPIO_SPREAD4(pins) ( \
+    (((pins) & 0x01U) << 0)  | (((pins) & 0x02U) << 3)  | (((pins) & 0x04U) << 6)  | (((pins) & 0x08U) << 9)  | \
+    (((pins) & 0x10U) << 12) | (((pins) & 0x20U) << 15) | (((pins) & 0x40U) << 18) | (((pins) & 0x80U) << 21))
+
+/* a set of pins of one port with the same configuration, folded into one masked
+   write per register (a zero mask leaves the register untouched) */
+typedef struct gpio_pinset_t {
+    GPIO_TypeDef *port;
+    uint32_t moder_mask;
+    uint32_t moder;
+    uint32_t otyper_mask;
+    uint32_t otyper;
+    uint32_t ospeedr_mask;
+    uint32_t ospeedr;
+    uint32_t pupdr_mask;
+    uint32_t pupdr;
+    uint32_t afr_mask[2];
+    uint32_t afr[2];
+} gpio_pinset_t;
+
+/* full configuration of a pin set */
+#define GPIO_PINSET(port_, pins_, mode_, otype_, speed_, pull_) {   \
+    .port           = (port_),                                      \
+    .moder_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .moder          = GPIO_SPREAD2(pins_) * (mode_),                \
+    .otyper_mask    = (pins_),                                      \
+    .otyper         = (pins_) * (otype_),                           \
+    .ospeedr_mask   = GPIO_SPREAD2(pins_) * 3U,                     \
+    .ospeedr        = GPIO_SPREAD2(pins_) * (speed_),               \
+    .pupdr_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .pupdr          = GPIO_SPREAD2(pins_) * (pull_)                 \
+}
+
+/* mode only (i.e. bus direction change) */
+#define GPIO_PINSET_MODE(port_, pins_, mode_) {                     \
+    .port           = (port_),                                      \
+    .moder_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .moder          = GPIO_SPREAD2(pins_) * (mode_)                 \
+}
+
+/* mode and pull (i.e. analog input) */
+#define GPIO_PINSET_MODE_PULL(port_, pins_, mode_, pull_) {         \
+    .port           = (port_),                                      \
+    .moder_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .moder          = GPIO_SPREAD2(pins_) * (mode_),                \
+    .pupdr_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .pupdr          = GPIO_SPREAD2(pins_) * (pull_)                 \
+}
+
+/* alternate function (i.e. USART pins) */
+#define GPIO_PINSET_AF(port_, pins_, af_, otype_, speed_, pull_) {  \
+    .port           = (port_),                                      \
+    .moder_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .moder          = GPIO_SPREAD2(pins_) * GPIO_MODE_AF,           \
+    .otyper_mask    = (pins_),                                      \
+    .otyper         = (pins_) * (otype_),                           \
+    .ospeedr_mask   = GPIO_SPREAD2(pins_) * 3U,                     \
+    .ospeedr        = GPIO_SPREAD2(pins_) * (speed_),               \
+    .pupdr_mask     = GPIO_SPREAD2(pins_) * 3U,                     \
+    .pupdr          = GPIO_SPREAD2(pins_) * (pull_),                \
+    .afr_mask       = { GPIO_SPREAD4(pins_) * 15U, GPIO_SPREAD4((pins_) >> 8) * 15U },      \
+    .afr            = { GPIO_SPREAD4(pins_) * (af_), GPIO_SPREAD4((pins_) >> 8) * (af_) }   \
+}
+
+void gpio_apply(const gpio_pinset_t *set);
+
 /* initialization */
 void gpio_init();
 
@@ -31,15 +31,61 @@
 #include "isr.h"
 #include "dma.h"
 #include "adc.h"
+#include "power.h"
+#include "timebase.h"
+#include "uart.h"
+#include "trace.h"
 
 void isr_init()
 {
     /* enable interupt */
     NVIC_SetPriority(DMA2_Stream0_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 11 /* PreemptPriority */, 0 /* SubPriority */));
     NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    NVIC_SetPriority(TIM2_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 10 /* PreemptPriority */, 0 /* SubPriority */));
+    NVIC_EnableIRQ(TIM2_IRQn);
+
+    NVIC_SetPriority(RTC_WKUP_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 12 /* PreemptPriority */, 0 /* SubPriority */));
+    NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+    NVIC_SetPriority(USART1_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 13 /* PreemptPriority */, 0 /* SubPriority */));
+    NVIC_EnableIRQ(USART1_IRQn);
+
+    NVIC_SetPriority(EXTI15_10_IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 13 /* PreemptPriority */, 0 /* SubPriority */));
+    NVIC_EnableIRQ(EXTI15_10_IRQn);
 }
 
 void DMA2_Stream0_IRQHandler(void)
 {
+  trace_isr_enter(DMA2_Stream0_IRQn);
   dma_isr_handler();
+  trace_isr_exit(DMA2_Stream0_IRQn);
+}
+
+void RTC_WKUP_IRQHandler(void)
+{
+  trace_isr_enter(RTC_WKUP_IRQn);
+  power_rtc_isr_handler();
+  trace_isr_exit(RTC_WKUP_IRQn);
+}
+
+void TIM2_IRQHandler(void)
+{
+  trace_isr_enter(TIM2_IRQn);
+  timebase_isr_handler();
+  trace_isr_exit(TIM2_IRQn);
+}
+
+void USART1_IRQHandler(void)
+{
+  trace_isr_enter(USART1_IRQn);
+  uart_isr_handler();
+  trace_isr_exit(USART1_IRQn);
+}
+
+void EXTI15_10_IRQHandler(void)
+{
+  trace_isr_enter(EXTI15_10_IRQn);
+  uart_wake_isr_handler();
+  trace_isr_exit(EXTI15_10_IRQn);
 }
@@ -25,6 +25,7 @@
  |                                                                            |
  |___________________________________________________________________________*/
 
+#include <string.h>
 #include "stm32f4xx.h"
 #include "stm32rtos.h"
 #include "queue.h"
@@ -32,17 +33,159 @@
 #include "printf.h"
 #include "gpio.h"
 #include "system.h"
+#include "dma.h"
+#include "bus.h"
+#include "trace.h"
+#include "lcdview.h"
 #include "lcd.h"
 
- /* Queue used to communicate LCD update messages. */
-QueueHandle_t lcd_queue = NULL;
+/* ST7066U: set CGRAM address command and the execution time of a command/data write
+   (the R/W line is not driven - the busy flag cannot be used) */
+#define LCD_CMD_SET_CGRAM       0x40
+#define LCD_EXEC_US             40
+
+/* 16x2 display; DDRAM address of the second row */
+#define LCD_ROWS                2
+#define LCD_COLUMNS             16
+#define LCD_ROW1_ADDRESS        0x40
+
+/* graph view: voltage (6 characters), a space and the trend of the last block means */
+#define LCD_TREND_CELLS         9
+
+/* the display shows the newest block only */
+static bus_subscriber_t *lcd_bus = NULL;
+
+/* view selected by the console */
+static volatile lcd_view_t lcd_view = LCD_VIEW_GRAPH;
+
+/* what the display holds: only the cells/glyphs that differ are written */
+static char lcd_shadow[LCD_ROWS][LCD_COLUMNS];
+static uint8_t lcd_cgram[LCDVIEW_GLYPHS][LCDVIEW_CELL_ROWS];
+static uint32_t lcd_cgram_valid = 0;
+
+/* block means for the trend, oldest first */
+static uint32_t lcd_trend[LCD_TREND_CELLS];
+static uint32_t lcd_trend_count = 0;
+
+/**
+ * one write cycle on the bus (the driver has no CGRAM access)
+ */
+static void lcd_bus_write(const uint32_t data_register, const uint8_t data)
+{
+    gpio_config_data_out();
+    if (data_register) {
+        gpio_rs_high();
+    } else {
+        gpio_rs_low();
+    }
+    gpio_data_wr(data);
+    delay_us(1);
+    gpio_e_high();
+    delay_us(1);
+    gpio_e_low();
+    delay_us(LCD_EXEC_US);
+    gpio_config_data_in();
+}
+
+/**
+ * upload a glyph if the display does not hold it already
+ */
+static void lcd_glyph(const uint32_t index, const uint8_t *rows)
+{
+    if ((lcd_cgram_valid & (1UL << index)) && (memcmp(lcd_cgram[index], rows, LCDVIEW_CELL_ROWS) == 0)) {
+        return;
+    }
+
+    lcd_bus_write(0, LCD_CMD_SET_CGRAM | (index * LCDVIEW_CELL_ROWS));
+    for (uint32_t i = 0; i < LCDVIEW_CELL_ROWS; i++) {
+        lcd_bus_write(1, rows[i]);
+    }
+    memcpy(lcd_cgram[index], rows, LCDVIEW_CELL_ROWS);
+    lcd_cgram_valid |= (1UL << index);
+}
+
+/**
+ * write the cells that changed since the last frame, one DDRAM address per run
+ */
+static void lcd_flush(const char frame[LCD_ROWS][LCD_COLUMNS])
+{
+    char run[LCD_COLUMNS + 1];
+
+    for (uint32_t row = 0; row < LCD_ROWS; row++) {
+        uint32_t column = 0;
+        while (column < LCD_COLUMNS) {
+            if (frame[row][column] == lcd_shadow[row][column]) {
+                column++;
+                continue;
+            }
+
+            uint32_t start = column;
+            uint32_t length = 0;
+            while ((column < LCD_COLUMNS) && (frame[row][column] != lcd_shadow[row][column])) {
+                run[length++] = frame[row][column];
+                lcd_shadow[row][column] = frame[row][column];
+                column++;
+            }
+            run[length] = '\0';
+
+            st7066u_cmd_set_ddram((uint8_t)((row ? LCD_ROW1_ADDRESS : 0) + start));
+            st7066u_write_str(run);
+        }
+    }
+}
+
+/**
+ * text view: voltage and duty cycle, block counter and raw sum
+ */
+static void lcd_render_text(char frame[LCD_ROWS][LCD_COLUMNS], const bus_block_t *block)
+{
+    char txt[2 * LCD_COLUMNS];
+    int length;
+
+    length = sprintf(txt, " %d.%04d V %3d.%d%%", (int)(block->microvolts / 1000000), (int)((block->microvolts % 1000000) / 100),
+        (int)(block->duty_cycle / 10), (int)(block->duty_cycle % 10));
+    memset(frame[0], ' ', LCD_COLUMNS);
+    memcpy(frame[0], txt, (length < LCD_COLUMNS) ? length : LCD_COLUMNS);
+
+    length = sprintf(txt, "%6d:%8d", (int)block->sequence, (int)block->digital_value);
+    memset(frame[1], ' ', LCD_COLUMNS);
+    memcpy(frame[1], txt, (length < LCD_COLUMNS) ? length : LCD_COLUMNS);
+}
+
+/**
+ * graph view: bar over the full scale on the first row, voltage and trend on the second
+ */
+static void lcd_render_graph(char frame[LCD_ROWS][LCD_COLUMNS])
+{
+    char txt[2 * LCD_COLUMNS];
+    uint8_t glyph[LCDVIEW_CELL_ROWS];
+    const uint32_t microvolts = lcd_trend[lcd_trend_count - 1];
+
+    if (lcdview_bar(frame[0], LCD_COLUMNS, microvolts, ACQ_VREF_UV, glyph)) {
+        lcd_glyph(LCDVIEW_GLYPH_BAR, glyph);
+    }
+
+    int length = sprintf(txt, "%d.%03dV", (int)(microvolts / 1000000), (int)((microvolts % 1000000) / 1000));
+    memset(frame[1], ' ', LCD_COLUMNS);
+    memcpy(frame[1], txt, (length < (LCD_COLUMNS - LCD_TREND_CELLS - 1)) ? length : (LCD_COLUMNS - LCD_TREND_CELLS - 1));
+    lcdview_trend(&frame[1][LCD_COLUMNS - lcd_trend_count], lcd_trend, lcd_trend_count);
+}
+
+static void lcd_trend_push(const uint32_t microvolts)
+{
+    if (lcd_trend_count == LCD_TREND_CELLS) {
+        memmove(&lcd_trend[0], &lcd_trend[1], (LCD_TREND_CELLS - 1) * sizeof(lcd_trend[0]));
+        lcd_trend_count--;
+    }
+    lcd_trend[lcd_trend_count++] = microvolts;
+}
 
 void vTaskDisplay(void *pvParameters)
 {
     (void)pvParameters;
 
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    char txt[17] = {0};
+    char frame[LCD_ROWS][LCD_COLUMNS];
 
     st7066u_hw_control_t hw = {
         .config_control_out  = gpio_config_control_out,
@@ -64,28 +207,66 @@ void vTaskDisplay(void *pvParameters)
     st7066u_cmd_clear_display();
     st7066u_cmd_entry_mode(ST7066U_INCREMENT_ADDRESS, ST7066U_SHIFT_DISABLED);
 
+    /* the glyphs of the trend levels 1..7 never change: upload them once (level 8 is
+       the ROM block) */
+    for (uint32_t i = 0; i < (LCDVIEW_GLYPHS - 1); i++) {
+        lcd_glyph(LCDVIEW_GLYPH_TREND + i, lcdview_trend_glyphs[i]);
+    }
+
+    /* the welcome screen stays until the first measurement arrives (the shadow is
+       what a full frame write leaves on the display) */
+    memcpy(lcd_shadow[0], "    Welcome!    ", LCD_COLUMNS);
+    memcpy(lcd_shadow[1], "ADC meas on PB0 ", LCD_COLUMNS);
+    st7066u_cmd_set_ddram(0x00);
     st7066u_write_str("    Welcome!    ");
-    st7066u_cmd_set_ddram(0x40);
-    st7066u_write_str("ADC meas on PB0");
-    vTaskDelay(2000 / portTICK_PERIOD_MS);
+    st7066u_cmd_set_ddram(LCD_ROW1_ADDRESS);
+    st7066u_write_str("ADC meas on PB0 ");
 
     for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, 250 / portTICK_PERIOD_MS);
-
-        lcd_event_t lcd_event;
-        if (xQueueReceive(lcd_queue, &lcd_event, portMAX_DELAY) == pdPASS) {
-            st7066u_cmd_clear_display();
-            sprintf(txt, "    %4.4f V    ", lcd_event.voltage);
-            st7066u_write_str(txt);
-            st7066u_cmd_set_ddram(0x40);
-            sprintf(txt, "%6d:%8d", lcd_event.mss_counter, lcd_event.digital_value);
-            st7066u_write_str(txt);
+        acq_config_t config;
+        const bus_block_t *block = bus_receive(lcd_bus, portMAX_DELAY);
+        if (block != NULL) {
+            const uint32_t sequence = block->sequence;
+            trace_mark(TRACE_MARK_DISPLAY_START, sequence);
+            lcd_trend_push(block->microvolts);
+            if (lcd_view == LCD_VIEW_TEXT) {
+                lcd_render_text(frame, block);
+            } else {
+                lcd_render_graph(frame);
+            }
+            bus_release(block);
+
+            lcd_flush((const char (*)[LCD_COLUMNS])frame);
+            trace_mark(TRACE_MARK_DISPLAY_END, sequence);
         }
+
+        /* refresh at most once per sampling window (the period can be changed at runtime) */
+        dma_get_config(&config);
+        vTaskDelayUntil(&xLastWakeTime, config.period_ms / portTICK_PERIOD_MS);
     }
 }
 
-
 void lcd_init()
 {
-    
+    lcd_bus = bus_subscribe("display", BUS_MODE_LATEST, 1);
+
+    /* a display without data is a configuration error (blink eight short flashes) */
+    if (lcd_bus == NULL) {
+        trace_record(TRACE_FAULT, 8, 0);
+        trace_stop();
+        blink(8);
+    }
+}
+
+/**
+ * select the view (console)
+ */
+void lcd_set_view(const lcd_view_t view)
+{
+    lcd_view = view;
+}
+
+lcd_view_t lcd_get_view()
+{
+    return lcd_view;
 }
@@ -27,15 +27,13 @@
 
 #pragma once
 
-/* lcd update event */
-typedef struct lcd_event_t {
-    float voltage;
-    uint32_t digital_value;
-    uint32_t mss_counter;
-} lcd_event_t;
-
-/* Queue used to communicate LCD update messages. */
-extern QueueHandle_t lcd_queue;
+/* what the display shows */
+typedef enum lcd_view_t {
+    LCD_VIEW_TEXT,              /* voltage, duty cycle, block counter and raw sum */
+    LCD_VIEW_GRAPH              /* bar graph, voltage and the trend of the last blocks */
+} lcd_view_t;
 
 void lcd_init();
+void lcd_set_view(const lcd_view_t view);
+lcd_view_t lcd_get_view();
 void vTaskDisplay(void *pvParameters);
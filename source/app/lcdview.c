@@ -0,0 +1,97 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "lcdview.h"
+
+/*
+    Bar graph and trend cells for the character display (no I/O - usable on the host
+    as well). The cells hold character codes, the glyphs they need are described by
+    lcdview_trend_glyphs and the glyph returned by lcdview_bar.
+*/
+
+/* trend levels 1..7: the lowest n pixel rows on (level 8 is LCDVIEW_CHAR_FULL) */
+const uint8_t lcdview_trend_glyphs[LCDVIEW_GLYPHS - 1][LCDVIEW_CELL_ROWS] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+    { 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F }
+};
+
+/**
+ * horizontal bar over count cells with a resolution of one pixel column (5 per cell);
+ * returns 1 if the partial cell is used - glyph holds its 8 rows then
+ */
+uint32_t lcdview_bar(char *cells, const uint32_t count, const uint32_t value, const uint32_t full_scale, uint8_t *glyph)
+{
+    uint32_t pixels = (uint32_t)(((uint64_t)value * count * LCDVIEW_CELL_COLUMNS) / full_scale);
+    if (pixels > (count * LCDVIEW_CELL_COLUMNS)) {
+        pixels = count * LCDVIEW_CELL_COLUMNS;
+    }
+
+    uint32_t full = pixels / LCDVIEW_CELL_COLUMNS;
+    uint32_t part = pixels % LCDVIEW_CELL_COLUMNS;
+
+    for (uint32_t i = 0; i < count; i++) {
+        cells[i] = (i < full) ? LCDVIEW_CHAR_FULL : ' ';
+    }
+    if (part == 0) {
+        return 0;
+    }
+
+    /* the leftmost columns of the cell after the full ones */
+    uint8_t row = (uint8_t)((0x1F << (LCDVIEW_CELL_COLUMNS - part)) & 0x1F);
+    for (uint32_t i = 0; i < LCDVIEW_CELL_ROWS; i++) {
+        glyph[i] = row;
+    }
+    cells[full] = LCDVIEW_CHAR(LCDVIEW_GLYPH_BAR);
+    return 1;
+}
+
+/**
+ * one column per value (oldest first), scaled to the 8 levels between the smallest
+ * (level 1) and the largest (level 8) value so that small changes are visible; a
+ * flat signal is drawn at half height (level 4)
+ */
+void lcdview_trend(char *cells, const uint32_t *values, const uint32_t count)
+{
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        min = (values[i] < min) ? values[i] : min;
+        max = (values[i] > max) ? values[i] : max;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t level = (max == min) ? (LCDVIEW_TREND_LEVELS / 2) :
+            (1 + (uint32_t)(((uint64_t)(values[i] - min) * (LCDVIEW_TREND_LEVELS - 1)) / (max - min)));
+        cells[i] = (level >= LCDVIEW_TREND_LEVELS) ? LCDVIEW_CHAR_FULL : LCDVIEW_CHAR(LCDVIEW_GLYPH_TREND + level - 1);
+    }
+}
@@ -0,0 +1,50 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include <stdint.h>
+
+/* pixels of a 5x8 character cell */
+#define LCDVIEW_CELL_COLUMNS    5
+#define LCDVIEW_CELL_ROWS       8
+
+/* CGRAM use: glyph 0 - the partial cell of the bar, 1..7 - the trend levels 1..7; the
+   trend has 8 levels (one per pixel row), level 8 and a full bar cell are the ROM
+   block 0xFF. The characters 8..15 are aliases of the glyphs 0..7 so that a string
+   never holds a 0 */
+#define LCDVIEW_GLYPH_BAR       0
+#define LCDVIEW_GLYPH_TREND     1
+#define LCDVIEW_GLYPHS          8
+#define LCDVIEW_TREND_LEVELS    LCDVIEW_CELL_ROWS
+#define LCDVIEW_CHAR(glyph)     ((char)(8 + (glyph)))
+#define LCDVIEW_CHAR_FULL       ((char)0xFF)
+
+extern const uint8_t lcdview_trend_glyphs[LCDVIEW_GLYPHS - 1][LCDVIEW_CELL_ROWS];
+
+uint32_t lcdview_bar(char *cells, const uint32_t count, const uint32_t value, const uint32_t full_scale, uint8_t *glyph);
+void lcdview_trend(char *cells, const uint32_t *values, const uint32_t count);
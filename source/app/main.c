@@ -35,11 +35,27 @@
 #include "dma.h"
 #include "isr.h"
 #include "lcd.h"
+#include "power.h"
+#include "boot.h"
+#include "timebase.h"
+#include "flash.h"
+#include "flashlog.h"
+#include "uart.h"
+#include "cmd.h"
+#include "console.h"
+#include "clock.h"
+#include "trace.h"
+
+/* low power statistics of the last LED cycle (read with the debugger) */
+power_stats_t power_report;
+uint32_t power_report_current_ua;
 
 static void vTaskLED(void *pvParameters)
 {
     (void)pvParameters;
 
+    boot_mark(BOOT_PHASE_SCHEDULER);
+
     /* led OFF */
     gpio_set_blue_led();
 
@@ -55,37 +71,79 @@ static void vTaskLED(void *pvParameters)
 
         gpio_set_blue_led();
         vTaskDelay(100 / portTICK_PERIOD_MS);
+
+        /* measurement harness: estimate the current draw from the sleep residency */
+        power_get_stats(&power_report);
+        power_report_current_ua = power_estimate_current_ua(&power_report);
+        power_reset_stats();
     }
 }
 
 int main(void)
 {
+    /* start the boot time measurement */
+    boot_init();
+
+    /* start the event trace (cycle time stamps from the DWT started by boot_init) */
+    trace_init(clock_get_info()->hclk_hz);
+    clock_register_listener(trace_clock_changed);
+
     /* initialize the system */
     system_init();
+    boot_mark(BOOT_PHASE_SYSTEM);
+
+    /* initialize the time base */
+    timebase_init();
 
     /* initialize the gpio */
     gpio_init();
+    boot_mark(BOOT_PHASE_GPIO);
 
     /* initialize the interupt service routines */
     isr_init();
+    boot_mark(BOOT_PHASE_ISR);
+
+    /* initialize the low power modes */
+    power_init();
+    boot_mark(BOOT_PHASE_POWER);
 
     /* initialize the dma */
     dma_init();
+    boot_mark(BOOT_PHASE_DMA);
 
     /* initialize the adc */
     adc_init();
+    boot_mark(BOOT_PHASE_ADC);
 
-    /* initialize the display */
+    /* initialize the display (display subscriber of the measurement bus) */
     lcd_init();
+    boot_mark(BOOT_PHASE_LCD);
+
+    /* initialize the measurement log in the internal flash (log subscriber) */
+    flashlog_hw_control_t flashlog_hw = {
+        .sector_address = flash_sector_address,
+        .sector_size    = flash_sector_size,
+        .erase_sector   = flash_erase_sector,
+        .program_word   = flash_program_word
+    };
+    flashlog_init(flashlog_hw);
 
     /* create the queues */
     dma_queue = xQueueCreate(1, sizeof(dma_event_t));
-    lcd_queue = xQueueCreate(1, sizeof(lcd_event_t));
+    uart_rx_queue = xQueueCreate(CMD_LINE_MAX + 1, sizeof(char));
+
+    trace_name(dma_queue, "dma");
+    trace_name(uart_rx_queue, "uart_rx");
+
+    /* initialize the command channel (receives into its queue) */
+    uart_init();
 
     /* create the tasks specific to this application. */
     xTaskCreate(vTaskLED, "vTaskLED", configMINIMAL_STACK_SIZE, NULL, 3, NULL);
     xTaskCreate(vTaskDisplay, "vTaskDisplay", configMINIMAL_STACK_SIZE*2, NULL, 2, NULL);
     xTaskCreate(vTaskDma, "vTaskDma", configMINIMAL_STACK_SIZE, NULL, 2, NULL);
+    xTaskCreate(vTaskConsole, "vTaskConsole", configMINIMAL_STACK_SIZE*3, NULL, 1, NULL);
+    xTaskCreate(vTaskLog, "vTaskLog", configMINIMAL_STACK_SIZE + (FLASHLOG_BATCH * sizeof(flashlog_record_t) / sizeof(StackType_t)), NULL, 1, NULL);
 
     /* start the scheduler. */
     vTaskStartScheduler();
@@ -0,0 +1,58 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "meas.h"
+
+/*
+    Block reduction and conversion used by vTaskDma. Plain C without any register or
+    RTOS dependency so that the same code can be fed with recorded or synthetic
+    traces on the host.
+*/
+
+/**
+ * sum of a block of packed samples (two 12 bit samples per word, length even)
+ */
+uint32_t meas_sum_packed(const uint32_t *buffer, const uint32_t length)
+{
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < length / 2; i++) {
+        uint32_t word = buffer[i];
+        sum += (word & 0xFFFF) + (word >> 16);
+    }
+
+    return sum;
+}
+
+/**
+ * average voltage of a block in uV from its sum and the scale of the block length
+ * (acq_derived_t) - one 32x32->64 multiply, no division
+ */
+uint32_t meas_microvolts(const uint32_t sum, const uint32_t scale_q24)
+{
+    return (uint32_t)(((uint64_t)sum * scale_q24) >> ACQ_SCALE_SHIFT);
+}
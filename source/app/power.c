@@ -0,0 +1,458 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "clock.h"
+#include "system.h"
+#include "boot.h"
+#include "timebase.h"
+#include "power.h"
+#include "trace.h"
+
+/*
+    Low power integration for the FreeRTOS tickless idle. freertos_config.h routes
+    the idle time to this module:
+
+        #define configUSE_TICKLESS_IDLE                 2
+        #define portSUPPRESS_TICKS_AND_SLEEP(x)         power_sleep(x)
+
+    SLEEP is used while a driver holds a STOP lock (the ADC and the DMA need the
+    clocks), otherwise the core enters STOP and the RTC wakeup timer brings it back
+    for the next task timeout. The RTC runs from the LSI (17..47kHz, ~32kHz typical)
+    which is measured against the HSE/HSI with TIM5 channel 4 at start up:
+        - calendar: PREDIV_A = 1, PREDIV_S = LSI/2 - 1 -> 1Hz calendar, the sub
+          seconds count in steps of two LSI periods (~62us)
+        - wakeup timer: RTCCLK/16
+    The time spent in STOP is handed to the time base in RTC sub second steps; the
+    fraction of a us left over is carried to the next STOP.
+*/
+
+/* shortest idle time in ticks for which STOP is worth the PLL relock */
+#define POWER_STOP_MIN_TICKS    5
+
+/* timeout for the LSI and the RTC synchronisation in us */
+#define POWER_TIMEOUT_US        5000
+
+/* timeout for the wakeup timer to become writable (2 RTCCLK periods, ~60us) in the idle path */
+#define POWER_WUTWF_TIMEOUT_US  200
+
+/* nominal LSI frequency (used if the measurement fails) */
+#define POWER_LSI_HZ            32000
+
+/* asynchronous RTC prescaler: LSI periods per sub second step (PREDIV_S stays below
+   2^15 up to 47kHz) */
+#define POWER_RTC_PREDIV_A      1
+
+/* LSI periods per TIM5 capture (IC4PSC = /8) and number of captures averaged */
+#define POWER_LSI_PSC           8
+#define POWER_LSI_CAPTURES      4
+
+/* approximate supply current per state (STM32F411, ADC off): base + slope * HCLK in MHz */
+typedef struct power_current_t {
+    uint32_t base_ua;
+    uint32_t ua_per_mhz;
+} power_current_t;
+
+static const power_current_t power_state_current[POWER_STATE_COUNT] = {
+    [POWER_STATE_RUN]   = { .base_ua = 1400, .ua_per_mhz = 100 },
+    [POWER_STATE_SLEEP] = { .base_ua = 680,  .ua_per_mhz = 45 },
+    [POWER_STATE_STOP]  = { .base_ua = 50,   .ua_per_mhz = 0 }
+};
+
+/* measured LSI frequency and the matching synchronous prescaler */
+static uint32_t power_lsi_hz = POWER_LSI_HZ;
+static uint32_t power_prediv_s = (POWER_LSI_HZ / (POWER_RTC_PREDIV_A + 1)) - 1;
+
+/* LSI periods x 10^6 of the last STOP not yet given to the time base (< lsi_hz) */
+static uint64_t power_stop_carry = 0;
+
+/* number of drivers that need the clocks (STOP is not allowed) */
+static volatile uint32_t stop_locks = 0;
+
+/* statistics */
+static power_stats_t power_stats = {0};
+
+/* start of the measurement window in ms of day (RTC) */
+static uint32_t stats_start_ms = 0;
+
+/**
+ * RTC sub second steps since midnight
+ */
+static uint32_t power_rtc_ticks()
+{
+    uint32_t tr, ssr;
+
+    /* the shadow registers are bypassed - read until two reads are consistent */
+    do {
+        tr  = RTC->TR;
+        ssr = RTC->SSR;
+    } while ((tr != RTC->TR) || (ssr != RTC->SSR));
+
+    uint32_t hours   = ((tr & RTC_TR_HT_Msk)  >> RTC_TR_HT_Pos)  * 10 + ((tr & RTC_TR_HU_Msk)  >> RTC_TR_HU_Pos);
+    uint32_t minutes = ((tr & RTC_TR_MNT_Msk) >> RTC_TR_MNT_Pos) * 10 + ((tr & RTC_TR_MNU_Msk) >> RTC_TR_MNU_Pos);
+    uint32_t seconds = ((tr & RTC_TR_ST_Msk)  >> RTC_TR_ST_Pos)  * 10 + ((tr & RTC_TR_SU_Msk)  >> RTC_TR_SU_Pos);
+
+    return (((hours * 60 + minutes) * 60 + seconds) * (power_prediv_s + 1)) + (power_prediv_s - ssr);
+}
+
+static uint32_t power_rtc_ms()
+{
+    return (uint32_t)(((uint64_t)power_rtc_ticks() * 1000) / (power_prediv_s + 1));
+}
+
+static uint32_t power_rtc_elapsed_ms(const uint32_t start)
+{
+    return (power_rtc_ms() + 86400000 - start) % 86400000;
+}
+
+static void power_account_wakeup()
+{
+    /* interrupts are masked - the source is still pending */
+    if (DMA2->LISR & DMA_LISR_TCIF0_Msk) {
+        power_stats.wakeups[POWER_WAKE_DMA]++;
+    } else if (RTC->ISR & RTC_ISR_WUTF_Msk) {
+        power_stats.wakeups[POWER_WAKE_RTC]++;
+    } else if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        power_stats.wakeups[POWER_WAKE_SYSTICK]++;
+    } else {
+        power_stats.wakeups[POWER_WAKE_OTHER]++;
+    }
+}
+
+/**
+ * measure the LSI with the TIM5 channel 4 input capture (TI4 remapped to the LSI)
+ */
+static uint32_t power_measure_lsi()
+{
+    const uint32_t tim_hz = clock_get_info()->tim_apb1_hz;
+    uint32_t first = 0, last = 0;
+    uint32_t lsi_hz = 0;
+
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM5EN);
+    MODIFY_REG(TIM5->OR, TIM_OR_TI4_RMP_Msk, TIM_OR_TI4_RMP_0);
+    TIM5->PSC = 0;
+    TIM5->ARR = 0xFFFFFFFF;
+    MODIFY_REG(TIM5->CCMR2, TIM_CCMR2_CC4S_Msk | TIM_CCMR2_IC4PSC_Msk, TIM_CCMR2_CC4S_0 | TIM_CCMR2_IC4PSC_0 | TIM_CCMR2_IC4PSC_1);
+    SET_BIT(TIM5->CCER, TIM_CCER_CC4E);
+    SET_BIT(TIM5->EGR, TIM_EGR_UG);
+    CLEAR_BIT(TIM5->SR, TIM_SR_CC4IF);
+    SET_BIT(TIM5->CR1, TIM_CR1_CEN);
+
+    /* reading CCR4 clears the capture flag */
+    uint32_t i;
+    for (i = 0; i <= POWER_LSI_CAPTURES; i++) {
+        if (!system_wait(&TIM5->SR, TIM_SR_CC4IF_Msk, TIM_SR_CC4IF, POWER_TIMEOUT_US)) {
+            break;
+        }
+        last = TIM5->CCR4;
+        if (i == 0) {
+            first = last;
+        }
+    }
+
+    CLEAR_BIT(TIM5->CR1, TIM_CR1_CEN);
+    CLEAR_BIT(TIM5->CCER, TIM_CCER_CC4E);
+    CLEAR_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM5EN);
+
+    if ((i > POWER_LSI_CAPTURES) && (last != first)) {
+        lsi_hz = (uint32_t)(((uint64_t)tim_hz * POWER_LSI_PSC * POWER_LSI_CAPTURES) / (last - first));
+    }
+
+    /* reject a measurement outside of the datasheet range */
+    return ((lsi_hz >= 17000) && (lsi_hz <= 47000)) ? lsi_hz : POWER_LSI_HZ;
+}
+
+/**
+ * a new clock changes the current model - start a new measurement window
+ */
+static void power_clock_changed(const clock_info_t *info)
+{
+    power_reset_stats();
+}
+
+void power_init()
+{
+    clock_register_listener(power_clock_changed);
+
+    /* enable the LSI and give the RTC access to it */
+    SET_BIT(RCC->CSR, RCC_CSR_LSION);
+    if (!system_wait(&RCC->CSR, RCC_CSR_LSIRDY_Msk, RCC_CSR_LSIRDY, POWER_TIMEOUT_US)) {
+        /* no RTC - never use STOP */
+        stop_locks++;
+        boot_fail(BOOT_FAIL_LSI);
+        return;
+    }
+    power_lsi_hz = power_measure_lsi();
+    power_prediv_s = (power_lsi_hz / (POWER_RTC_PREDIV_A + 1)) - 1;
+
+    SET_BIT(PWR->CR, PWR_CR_DBP);
+    if ((RCC->BDCR & RCC_BDCR_RTCEN_Msk) == 0) {
+        MODIFY_REG(RCC->BDCR, RCC_BDCR_RTCSEL_Msk, RCC_BDCR_RTCSEL_1);
+        SET_BIT(RCC->BDCR, RCC_BDCR_RTCEN);
+    }
+
+    /* unlock the RTC registers */
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+
+    /* ms resolution calendar */
+    SET_BIT(RTC->ISR, RTC_ISR_INIT);
+    if (!system_wait(&RTC->ISR, RTC_ISR_INITF_Msk, RTC_ISR_INITF, POWER_TIMEOUT_US)) {
+        CLEAR_BIT(RTC->ISR, RTC_ISR_INIT);
+        stop_locks++;
+        boot_fail(BOOT_FAIL_RTC);
+        return;
+    }
+    RTC->PRER = power_prediv_s;
+    RTC->PRER = (POWER_RTC_PREDIV_A << RTC_PRER_PREDIV_A_Pos) | power_prediv_s;
+    SET_BIT(RTC->CR, RTC_CR_BYPSHAD);
+    CLEAR_BIT(RTC->ISR, RTC_ISR_INIT);
+
+    /* wakeup timer: RTCCLK/16, interrupt enabled, started only before STOP */
+    CLEAR_BIT(RTC->CR, RTC_CR_WUTE);
+    if (!system_wait(&RTC->ISR, RTC_ISR_WUTWF_Msk, RTC_ISR_WUTWF, POWER_TIMEOUT_US)) {
+        stop_locks++;
+        boot_fail(BOOT_FAIL_RTC);
+        return;
+    }
+    MODIFY_REG(RTC->CR, RTC_CR_WUCKSEL_Msk, 0);
+    SET_BIT(RTC->CR, RTC_CR_WUTIE);
+
+    /* the RTC wakeup is routed through EXTI line 22 (rising edge) */
+    SET_BIT(EXTI->IMR, EXTI_IMR_MR22);
+    SET_BIT(EXTI->RTSR, EXTI_RTSR_TR22);
+
+    /* STOP: low power regulator and flash in power down */
+    SET_BIT(PWR->CR, PWR_CR_LPDS | PWR_CR_FPDS);
+    CLEAR_BIT(PWR->CR, PWR_CR_PDDS);
+
+    /* keep the debug connection alive in the low power modes (only if a debugger is attached) */
+    if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk) {
+        SET_BIT(DBGMCU->CR, DBGMCU_CR_DBG_SLEEP | DBGMCU_CR_DBG_STOP);
+    }
+
+    stats_start_ms = power_rtc_ms();
+}
+
+/**
+ * prevent the STOP mode (i.e. a DMA transfer is ongoing)
+ */
+void power_stop_lock()
+{
+    taskENTER_CRITICAL();
+    stop_locks++;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * same from an interupt (i.e. a wake up that needs the clocks afterwards)
+ */
+void power_stop_lock_from_isr()
+{
+    UBaseType_t status = taskENTER_CRITICAL_FROM_ISR();
+    stop_locks++;
+    taskEXIT_CRITICAL_FROM_ISR(status);
+}
+
+void power_stop_unlock()
+{
+    taskENTER_CRITICAL();
+    if (stop_locks > 0) {
+        stop_locks--;
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void power_enter_sleep()
+{
+    /* SysTick keeps running in SLEEP - use it to measure the residency */
+    uint32_t load = SysTick->LOAD + 1;
+    uint32_t start = SysTick->VAL;
+
+    CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+    __DSB();
+    __WFI();
+
+    uint32_t end = SysTick->VAL;
+    uint32_t cycles = (start >= end) ? (start - end) : (start + load - end);
+
+    power_stats.residency_us[POWER_STATE_SLEEP] += cycles / (clock_get_info()->hclk_hz / 1000000);
+    trace_record(TRACE_SLEEP, POWER_STATE_SLEEP, cycles);
+    power_stats.entries[POWER_STATE_SLEEP]++;
+    power_account_wakeup();
+}
+
+/**
+ * arm the wakeup timer for the expected idle time (16 bit counter); 0 - the timer
+ * did not get writable in time (the caller uses SLEEP instead)
+ */
+static uint32_t power_arm_wakeup(uint32_t expected_idle_ticks)
+{
+    uint64_t wut = ((uint64_t)(expected_idle_ticks - 1) * (power_lsi_hz / 16)) / configTICK_RATE_HZ;
+    if (wut > 0xFFFF) {
+        wut = 0xFFFF;
+    }
+
+    CLEAR_BIT(RTC->CR, RTC_CR_WUTE);
+    if (!system_wait(&RTC->ISR, RTC_ISR_WUTWF_Msk, RTC_ISR_WUTWF, POWER_WUTWF_TIMEOUT_US)) {
+        power_stats.stop_aborts++;
+        return 0;
+    }
+    RTC->WUTR = (uint32_t)wut;
+    CLEAR_BIT(RTC->ISR, RTC_ISR_WUTF);
+    SET_BIT(EXTI->PR, EXTI_PR_PR22);
+    SET_BIT(RTC->CR, RTC_CR_WUTE);
+    return 1;
+}
+
+static void power_enter_stop(uint32_t expected_idle_ticks)
+{
+    /* the SysTick does not run in STOP */
+    CLEAR_BIT(SysTick->CTRL, SysTick_CTRL_ENABLE_Msk);
+
+    uint32_t start = power_rtc_ticks();
+
+    SET_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+    __DSB();
+    __WFI();
+
+    /* stamp the wake up before the clock restore: TIM2 counts again from here on */
+    uint32_t end = power_rtc_ticks();
+    CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+
+    /* back on HSI - restore the clock profile before anything else */
+    clock_restore();
+    CLEAR_BIT(RTC->CR, RTC_CR_WUTE);
+
+    /* steps of (PREDIV_A + 1) LSI periods to us, the remainder is kept for the next STOP */
+    const uint32_t day_ticks = 86400 * (power_prediv_s + 1);
+    uint32_t steps = (end + day_ticks - start) % day_ticks;
+    uint64_t scaled = ((uint64_t)steps * (POWER_RTC_PREDIV_A + 1) * 1000000) + power_stop_carry;
+    uint32_t elapsed_us = (uint32_t)(scaled / power_lsi_hz);
+    power_stop_carry = scaled % power_lsi_hz;
+
+    timebase_advance_us(elapsed_us);
+    trace_record(TRACE_SLEEP, POWER_STATE_STOP, elapsed_us);
+    power_stats.residency_us[POWER_STATE_STOP] += elapsed_us;
+    power_stats.entries[POWER_STATE_STOP]++;
+    power_account_wakeup();
+
+    /* correct the kernel tick count and restart the SysTick */
+    uint32_t elapsed_ticks = (uint32_t)(((uint64_t)elapsed_us * configTICK_RATE_HZ) / 1000000);
+    if (elapsed_ticks > expected_idle_ticks) {
+        elapsed_ticks = expected_idle_ticks;
+    }
+    vTaskStepTick(elapsed_ticks);
+
+    SysTick->VAL = 0;
+    SET_BIT(SysTick->CTRL, SysTick_CTRL_ENABLE_Msk);
+}
+
+/**
+ * tickless idle - called by the idle task with the scheduler suspended
+ */
+void power_sleep(uint32_t expected_idle_ticks)
+{
+    /* the boot profile is measured with the DWT which stops in the sleep modes */
+    if (!boot_done()) {
+        return;
+    }
+
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    if (eTaskConfirmSleepModeStatus() != eAbortSleep) {
+        if ((stop_locks == 0) && (expected_idle_ticks >= POWER_STOP_MIN_TICKS) && power_arm_wakeup(expected_idle_ticks)) {
+            power_enter_stop(expected_idle_ticks);
+        } else {
+            power_enter_sleep();
+        }
+    }
+
+    __enable_irq();
+}
+
+void power_get_stats(power_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = power_stats;
+    taskEXIT_CRITICAL();
+    stats->hclk_hz = clock_get_info()->hclk_hz;
+
+    /* what is not spent sleeping is spent running (the window must be shorter than a day) */
+    uint64_t total_us = (uint64_t)power_rtc_elapsed_ms(stats_start_ms) * 1000;
+    uint64_t sleep_us = stats->residency_us[POWER_STATE_SLEEP] + stats->residency_us[POWER_STATE_STOP];
+    stats->residency_us[POWER_STATE_RUN] = (total_us > sleep_us) ? (total_us - sleep_us) : 0;
+}
+
+/**
+ * start a new measurement window
+ */
+void power_reset_stats()
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        power_stats.residency_us[i] = 0;
+        power_stats.entries[i] = 0;
+    }
+    for (int i = 0; i < POWER_WAKE_COUNT; i++) {
+        power_stats.wakeups[i] = 0;
+    }
+    power_stats.stop_aborts = 0;
+    stats_start_ms = power_rtc_ms();
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * estimate the average supply current from the residency in each state
+ * (a window never spans a clock change, see power_clock_changed())
+ */
+uint32_t power_estimate_current_ua(const power_stats_t *stats)
+{
+    const uint32_t hclk_mhz = stats->hclk_hz / 1000000;
+    uint64_t charge = 0;
+    uint64_t total_us = 0;
+
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        const uint32_t current_ua = power_state_current[i].base_ua + power_state_current[i].ua_per_mhz * hclk_mhz;
+        charge   += stats->residency_us[i] * current_ua;
+        total_us += stats->residency_us[i];
+    }
+
+    return (total_us > 0) ? (uint32_t)(charge / total_us) : 0;
+}
+
+void power_rtc_isr_handler()
+{
+    if (RTC->ISR & RTC_ISR_WUTF_Msk) {
+        CLEAR_BIT(RTC->ISR, RTC_ISR_WUTF);
+    }
+    SET_BIT(EXTI->PR, EXTI_PR_PR22);
+}
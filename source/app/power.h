@@ -0,0 +1,64 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/* sleep states ordered by depth */
+typedef enum power_state_t {
+    POWER_STATE_RUN,
+    POWER_STATE_SLEEP,          /* WFI, all clocks running - DMA/ADC keep working */
+    POWER_STATE_STOP,           /* deep sleep, PLL/HSE off, low power regulator - woken by the RTC */
+    POWER_STATE_COUNT
+} power_state_t;
+
+/* wake up sources */
+typedef enum power_wake_source_t {
+    POWER_WAKE_SYSTICK,
+    POWER_WAKE_DMA,
+    POWER_WAKE_RTC,
+    POWER_WAKE_OTHER,
+    POWER_WAKE_COUNT
+} power_wake_source_t;
+
+/* residency counters */
+typedef struct power_stats_t {
+    uint64_t residency_us[POWER_STATE_COUNT];
+    uint32_t entries[POWER_STATE_COUNT];
+    uint32_t wakeups[POWER_WAKE_COUNT];
+    uint32_t stop_aborts;       /* STOP replaced by SLEEP: the wakeup timer did not get writable */
+    uint32_t hclk_hz;           /* core clock during the window */
+} power_stats_t;
+
+void power_init();
+void power_stop_lock();
+void power_stop_lock_from_isr();
+void power_stop_unlock();
+void power_sleep(uint32_t expected_idle_ticks);
+void power_get_stats(power_stats_t *stats);
+void power_reset_stats();
+uint32_t power_estimate_current_ua(const power_stats_t *stats);
+void power_rtc_isr_handler();
@@ -29,58 +29,17 @@
 #include "stm32f4xx_hal.h"
 #include "stm32rtos.h"
 #include "gpio.h"
+#include "clock.h"
 #include "system.h"
+#include "trace.h"
 
 void system_init()
 {
     /* configure Flash prefetch, Instruction cache, Data cache */ 
     SET_BIT(FLASH->ACR, FLASH_ACR_ICEN | FLASH_ACR_DCEN | FLASH_ACR_PRFTEN);
 
-    /* configure the main internal regulator output voltage */
+    /* enable the power interface (the regulator voltage scale is part of the clock profile) */
     SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
-    MODIFY_REG(PWR->CR, PWR_CR_VOS, PWR_REGULATOR_VOLTAGE_SCALE2);
-
-    /* enable the external High Speed Clock */
-    SET_BIT(RCC->CR, RCC_CR_HSEON);
-    do {
-    } while ((RCC->CR & RCC_CR_HSERDY_Msk) != RCC_CR_HSERDY);
-
-    /* configure the PLL */
-    MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLSRC_Msk, RCC_PLLCFGR_PLLSRC_HSE);
-    MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLM_Msk, 25 << RCC_PLLCFGR_PLLM_Pos);
-    MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLN_Msk, 192 << RCC_PLLCFGR_PLLN_Pos);
-    MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLP_Msk, 0);
-    MODIFY_REG(RCC->PLLCFGR, RCC_PLLCFGR_PLLQ_Msk, 4 << RCC_PLLCFGR_PLLQ_Pos);
-
-    /* enable PLL clock generation */
-    SET_BIT(RCC->CR, RCC_CR_PLLON);
-    do {
-    } while ((RCC->CR & RCC_CR_PLLRDY_Msk) != RCC_CR_PLLRDY);
-
-    /* to correctly read data from FLASH memory, the number of wait states (LATENCY) 
-       must be correctly programmed according to the frequency of the CPU clock 
-       (HCLK) of the device. */
-    MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY_Msk, FLASH_ACR_LATENCY_3WS);
-
-    /* set the highest APBx dividers in order to ensure that we do not go through
-        a non-spec phase whatever we decrease or increase HCLK. */
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE1_Msk, RCC_CFGR_PPRE1_DIV16);
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2_Msk, RCC_CFGR_PPRE2_DIV16);
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE_Msk, RCC_CFGR_HPRE_DIV1);
-
-    /* set the SYSCLK to PLL */
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW_Msk, RCC_CFGR_SW_PLL);
-    do {
-    } while ((RCC->CFGR & RCC_CFGR_SWS_Msk) != RCC_CFGR_SWS_PLL);
-
-    /* disable HSI clock */
-    CLEAR_BIT(RCC->CR, RCC_CR_HSION);
-    do {
-    } while ((RCC->CR & RCC_CR_HSIRDY_Msk) == RCC_CR_HSIRDY);
-
-    /* confgure the APB clocks */
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE1_Msk, RCC_CFGR_PPRE1_DIV2);
-    MODIFY_REG(RCC->CFGR, RCC_CFGR_PPRE2_Msk, RCC_CFGR_PPRE2_DIV2);
 
     /* enable AHB1 ports clock */
     SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOAEN);
@@ -89,18 +48,46 @@ void system_init()
     SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOHEN);
     SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA2EN);
 
+    /* enable APB1 devices */
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_TIM2EN);
+
     /* enable APB2 devices */
     SET_BIT(RCC->APB2ENR, RCC_APB2ENR_ADC1EN);
     SET_BIT(RCC->APB2ENR, RCC_APB2ENR_TIM10EN);
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_USART1EN);
+    SET_BIT(RCC->APB2ENR, RCC_APB2ENR_SYSCFGEN);
+
+    /* start on the HSI (already running after reset) and let the crystal start in
+       the background - the switch to the PLL is done once the sampling runs */
+    clock_set_profile(CLOCK_PROFILE_HSI);
+    clock_start_hse();
+    clock_request_profile(CLOCK_PROFILE_PERFORMANCE);
 
     /* one us timer for delay */
-    TIM10->PSC = (configCPU_CLOCK_HZ / 1000000) - 1;
     MODIFY_REG(TIM10->CR1, TIM_CR1_CEN_Msk, TIM_CR1_CEN);
 
     /* stop timer when debuggng */
     SET_BIT(DBGMCU->APB2FZ, DBGMCU_APB2_FZ_DBG_TIM10_STOP);
 }
 
+/**
+ * wait for (reg & mask) == value with a timeout in us (blocking)
+ * Uses the DWT cycle counter (started by boot_init) - returns 0 on timeout.
+ */
+uint32_t system_wait(volatile uint32_t *reg, const uint32_t mask, const uint32_t value, const uint32_t timeout_us)
+{
+    const uint32_t start = DWT->CYCCNT;
+    const uint32_t cycles = timeout_us * (clock_get_info()->hclk_hz / 1000000);
+
+    do {
+        if ((*reg & mask) == value) {
+            return 1;
+        }
+    } while ((DWT->CYCCNT - start) < cycles);
+
+    return 0;
+}
+
 /**
  * delay in us (blockig)
  */
@@ -118,6 +105,8 @@ void delay_us(const uint32_t us)
 */
 void blink(const uint8_t n)
 {
+    const uint32_t cycles_per_ms = clock_get_info()->hclk_hz / 1000;
+
     /* enable DWT */
     CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
@@ -127,15 +116,15 @@ void blink(const uint8_t n)
             gpio_set_blue_led();
             DWT->CYCCNT = 0;
             do {
-            } while (DWT->CYCCNT < (100 * (configCPU_CLOCK_HZ / 1000)));
+            } while (DWT->CYCCNT < (100 * cycles_per_ms));
 
             gpio_reset_blue_led();
             DWT->CYCCNT = 0;
             do {
-            } while (DWT->CYCCNT < (400 * (configCPU_CLOCK_HZ / 1000)));
+            } while (DWT->CYCCNT < (400 * cycles_per_ms));
         }
         do {
-        } while (DWT->CYCCNT < (2000 * (configCPU_CLOCK_HZ / 1000)));
+        } while (DWT->CYCCNT < (2000 * cycles_per_ms));
     }
 }
 
@@ -148,20 +137,31 @@ int _write(int file, char *ptr, int len)
     return len;
 }
 
+/*
+    The faults are recorded in the event trace which is frozen afterwards so that the
+    debugger can read the last events (make trace-dump).
+*/
+
 /** Hard fault - blink four short flash every two seconds */
 void HardFault_Handler()
 {
+    trace_record(TRACE_FAULT, 4, SCB->CFSR);
+    trace_stop();
     blink(4);
 }
 
 /** Bus fault - blink five short flashes every two seconds */
 void BusFault_Handler()
 {
+    trace_record(TRACE_FAULT, 5, SCB->CFSR);
+    trace_stop();
     blink(5);
 }
 
 /** Usage fault - blink six short flashes every two seconds */
 void UsageFault_Handler()
 {
+    trace_record(TRACE_FAULT, 6, SCB->CFSR);
+    trace_stop();
     blink(6);
 }
@@ -28,5 +28,6 @@
 #pragma once
 
 void system_init();
+uint32_t system_wait(volatile uint32_t *reg, const uint32_t mask, const uint32_t value, const uint32_t timeout_us);
 void delay_us(const uint32_t us);
 void blink(const uint8_t n);
@@ -0,0 +1,128 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "clock.h"
+#include "timebase.h"
+
+/*
+    Free running 1us time base on TIM2 (32 bit) extended to 64 bit by counting the
+    overflows. TIM2 keeps running in SLEEP; the time spent in STOP is added by the
+    low power module from the RTC.
+*/
+
+/* upper 32 bit of the time base */
+static volatile uint32_t timebase_overflows = 0;
+
+static void timebase_set_prescaler(const clock_info_t *info)
+{
+    TIM2->PSC = (info->tim_apb1_hz / 1000000) - 1;
+}
+
+void timebase_init()
+{
+    timebase_set_prescaler(clock_get_info());
+    TIM2->ARR = 0xFFFFFFFF;
+    TIM2->CNT = 0;
+
+    /* load the prescaler, then count the overflows */
+    SET_BIT(TIM2->EGR, TIM_EGR_UG);
+    CLEAR_BIT(TIM2->SR, TIM_SR_UIF);
+    SET_BIT(TIM2->DIER, TIM_DIER_UIE);
+    MODIFY_REG(TIM2->CR1, TIM_CR1_CEN_Msk, TIM_CR1_CEN);
+
+    clock_register_listener(timebase_clock_changed);
+}
+
+/**
+ * current time in us since timebase_init (callable from interupts)
+ */
+uint64_t timebase_now_us()
+{
+    uint32_t hi, lo, pending;
+
+    do {
+        hi = timebase_overflows;
+        lo = TIM2->CNT;
+        pending = TIM2->SR & TIM_SR_UIF;
+    } while (hi != timebase_overflows);
+
+    /* an overflow not yet handled (interupts masked or a higher priority interupt) */
+    if (pending && (lo < 0x80000000)) {
+        hi++;
+    }
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * move the time base forward (time spent with the timer stopped) - interupts must be disabled
+ */
+void timebase_advance_us(const uint32_t us)
+{
+    uint32_t cnt = TIM2->CNT;
+    uint32_t next = cnt + us;
+
+    if (next < cnt) {
+        timebase_overflows++;
+    }
+    TIM2->CNT = next;
+}
+
+/**
+ * clock listener: the new prescaler only loads on an update event - force one and
+ * keep the counter value. The forced update clears UIF: an overflow still pending is
+ * moved into the high word first (the same rule as timebase_now_us - an overflow
+ * after the counter was read is counted again by the restored counter).
+ */
+void timebase_clock_changed(const clock_info_t *info)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t cnt = TIM2->CNT;
+    if ((TIM2->SR & TIM_SR_UIF) && (cnt < 0x80000000)) {
+        timebase_overflows++;
+    }
+    timebase_set_prescaler(info);
+    CLEAR_BIT(TIM2->DIER, TIM_DIER_UIE);
+    SET_BIT(TIM2->EGR, TIM_EGR_UG);
+    CLEAR_BIT(TIM2->SR, TIM_SR_UIF);
+    TIM2->CNT = cnt;
+    SET_BIT(TIM2->DIER, TIM_DIER_UIE);
+
+    __set_PRIMASK(primask);
+}
+
+void timebase_isr_handler()
+{
+    if (TIM2->SR & TIM_SR_UIF) {
+        CLEAR_BIT(TIM2->SR, TIM_SR_UIF);
+        timebase_overflows++;
+    }
+}
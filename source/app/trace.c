@@ -0,0 +1,139 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <string.h>
+#include "stm32f4xx.h"
+#include "trace.h"
+
+/*
+    Event trace recorder: a ring of fixed size events with cycle time stamps. A slot
+    is reserved with LDREX/STREX on the head so that tasks and nested interupts can
+    record without a critical section (an exception clears the exclusive monitor
+    and the interupted reservation is retried). The ring always keeps the last
+    TRACE_EVENTS events; it is frozen by a fault and by a dump.
+*/
+
+trace_t trace;
+
+void trace_init(const uint32_t hclk_hz)
+{
+    memset(&trace, 0, sizeof(trace));
+    trace.magic = TRACE_MAGIC;
+    trace.size = TRACE_EVENTS;
+    trace.hclk_hz = hclk_hz;
+    trace.enabled = TRACE_ENABLE;
+}
+
+/**
+ * record one event (task, interupt or fault context)
+ */
+void trace_record(const uint8_t id, const uint8_t arg, const uint32_t data)
+{
+    uint32_t index;
+
+    if (!trace.enabled) {
+        return;
+    }
+
+    do {
+        index = __LDREXW(&trace.head);
+    } while (__STREXW(index + 1, &trace.head) != 0);
+
+    trace_event_t *event = &trace.event[index & (TRACE_EVENTS - 1)];
+    event->cycles = DWT->CYCCNT;
+    event->id = id;
+    event->arg = arg;
+    event->data = data;
+
+    /* the sequence marks the event as complete: no store may move past it (compiler
+       and bus) */
+    __DMB();
+    event->sequence = (uint16_t)index;
+}
+
+/**
+ * name a task or a queue for the host tool (the first TRACE_OBJECTS only)
+ */
+void trace_name(const void *handle, const char *name)
+{
+    uint32_t index;
+
+    do {
+        index = __LDREXW(&trace.objects);
+        if (index >= TRACE_OBJECTS) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(index + 1, &trace.objects) != 0);
+
+    trace.object[index].handle = (uint32_t)handle;
+    strncpy(trace.object[index].name, name, TRACE_NAME_LEN - 1);
+}
+
+/**
+ * clock listener: the host needs the core clock to convert the cycles
+ */
+void trace_clock_changed(const clock_info_t *info)
+{
+    trace_record(TRACE_CLOCK, 0, info->hclk_hz);
+}
+
+void trace_stop()
+{
+    trace.enabled = 0;
+}
+
+void trace_start()
+{
+    trace.enabled = TRACE_ENABLE;
+}
+
+/**
+ * send the recorder over the ITM (SWO) as 32 bit words: header, objects and
+ * events in ring order. The recording is paused during the dump; returns the
+ * number of words sent (0 - ITM or the port not enabled by the debugger).
+ */
+uint32_t trace_dump_itm()
+{
+    if (((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0) || ((ITM->TER & (1UL << TRACE_ITM_PORT)) == 0)) {
+        return 0;
+    }
+
+    uint32_t enabled = trace.enabled;
+    trace.enabled = 0;
+
+    const uint32_t *word = (const uint32_t *)&trace;
+    uint32_t count = sizeof(trace) / sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; i++) {
+        while (ITM->PORT[TRACE_ITM_PORT].u32 == 0) {
+        }
+        ITM->PORT[TRACE_ITM_PORT].u32 = word[i];
+    }
+
+    trace.enabled = enabled;
+    return count;
+}
@@ -0,0 +1,120 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+#include <stdint.h>
+#include "clock_profile.h"
+
+/* 0 - no trace: the hooks compile to nothing */
+#define TRACE_ENABLE            1
+
+/* ring size in events (power of two) and named objects (tasks, queues) */
+#define TRACE_EVENTS            512
+#define TRACE_OBJECTS           16
+#define TRACE_NAME_LEN          12
+
+/* "TRCE" - lets the host find the recorder in a RAM dump */
+#define TRACE_MAGIC             0x45435254
+
+/* ITM stimulus port of the binary dump (port 0 is printf) */
+#define TRACE_ITM_PORT          1
+
+_Static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+
+/* event types */
+typedef enum trace_id_t {
+    TRACE_ISR_ENTER,            /* arg: IRQ number */
+    TRACE_ISR_EXIT,             /* arg: IRQ number */
+    TRACE_TASK_IN,              /* data: task (TCB) */
+    TRACE_TASK_OUT,             /* data: task (TCB) */
+    TRACE_QUEUE_SEND,           /* data: queue, arg: 1 - from an ISR */
+    TRACE_QUEUE_SEND_FAILED,    /* data: queue, arg: 1 - from an ISR */
+    TRACE_QUEUE_RECEIVE,        /* data: queue, arg: 1 - from an ISR */
+    TRACE_QUEUE_RECEIVE_FAILED, /* data: queue, arg: 1 - from an ISR */
+    TRACE_CLOCK,                /* data: new HCLK in Hz */
+    TRACE_SLEEP,                /* arg: power state, data: SLEEP - cycles, STOP - us (the cycle counter stops) */
+    TRACE_MARK,                 /* arg: trace_mark_t, data: free */
+    TRACE_FAULT                 /* arg: fault (blink code), data: CFSR */
+} trace_id_t;
+
+/* custom markers */
+typedef enum trace_mark_t {
+    TRACE_MARK_BURST_START,     /* data: sample index */
+    TRACE_MARK_BURST_END,       /* data: duty cycle in per mille */
+    TRACE_MARK_BLOCK_DROPPED,   /* data: dropped blocks so far */
+    TRACE_MARK_BLOCK_LOST,      /* data: lost blocks so far */
+    TRACE_MARK_CONFIG,          /* data: block size */
+    TRACE_MARK_DISPLAY_START,   /* data: message counter */
+    TRACE_MARK_DISPLAY_END,     /* data: message counter */
+    TRACE_MARK_BOOT_FAIL,       /* data: boot_failure_t bits */
+    TRACE_MARK_DMA_TIMEOUT,     /* data: stream park timeouts so far */
+    TRACE_MARK_CLOCK_REJECTED,  /* data: clock profile refused by a driver */
+    TRACE_MARK_WINDOW_SKIPPED   /* data: windows skipped for a flash erase so far */
+} trace_mark_t;
+
+/* one event: 12 bytes, the sequence is written last so that a reader can tell a
+   slot that was interupted while being filled */
+typedef struct trace_event_t {
+    uint32_t cycles;            /* DWT cycle counter */
+    uint8_t id;                 /* trace_id_t */
+    uint8_t arg;
+    uint16_t sequence;          /* low 16 bits of the reservation index */
+    uint32_t data;
+} trace_event_t;
+
+typedef struct trace_object_t {
+    uint32_t handle;
+    char name[TRACE_NAME_LEN];
+} trace_object_t;
+
+/* the recorder: readable as a whole by the debugger after a fault */
+typedef struct trace_t {
+    uint32_t magic;
+    uint32_t size;              /* TRACE_EVENTS */
+    volatile uint32_t head;     /* events reserved so far (the ring keeps the last TRACE_EVENTS) */
+    volatile uint32_t enabled;
+    uint32_t hclk_hz;           /* core clock when the recording started */
+    volatile uint32_t objects;
+    trace_object_t object[TRACE_OBJECTS];
+    trace_event_t event[TRACE_EVENTS];
+} trace_t;
+
+extern trace_t trace;
+
+void trace_init(const uint32_t hclk_hz);
+void trace_record(const uint8_t id, const uint8_t arg, const uint32_t data);
+void trace_name(const void *handle, const char *name);
+void trace_stop();
+void trace_start();
+uint32_t trace_dump_itm();
+void trace_clock_changed(const clock_info_t *info);
+
+/* shortcuts */
+#define trace_isr_enter(irq)        trace_record(TRACE_ISR_ENTER, (uint8_t)(irq), 0)
+#define trace_isr_exit(irq)         trace_record(TRACE_ISR_EXIT, (uint8_t)(irq), 0)
+#define trace_mark(mark, data)      trace_record(TRACE_MARK, (uint8_t)(mark), (uint32_t)(data))
@@ -0,0 +1,56 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/*
+    FreeRTOS trace hooks feeding the trace recorder. Included by freertos_config.h,
+    the prefix header of the kernel and of the application, so that the kernel
+    sources see the macros.
+*/
+
+#ifndef __ASSEMBLER__
+
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+#define traceTASK_CREATE(pxNewTCB)                  trace_name((pxNewTCB), (pxNewTCB)->pcTaskName)
+#define traceTASK_SWITCHED_IN()                     trace_record(TRACE_TASK_IN, 0, (uint32_t)pxCurrentTCB)
+#define traceTASK_SWITCHED_OUT()                    trace_record(TRACE_TASK_OUT, 0, (uint32_t)pxCurrentTCB)
+
+#define traceQUEUE_SEND(pxQueue)                    trace_record(TRACE_QUEUE_SEND, 0, (uint32_t)(pxQueue))
+#define traceQUEUE_SEND_FAILED(pxQueue)             trace_record(TRACE_QUEUE_SEND_FAILED, 0, (uint32_t)(pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)           trace_record(TRACE_QUEUE_SEND, 1, (uint32_t)(pxQueue))
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue)    trace_record(TRACE_QUEUE_SEND_FAILED, 1, (uint32_t)(pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)                 trace_record(TRACE_QUEUE_RECEIVE, 0, (uint32_t)(pxQueue))
+#define traceQUEUE_RECEIVE_FAILED(pxQueue)          trace_record(TRACE_QUEUE_RECEIVE_FAILED, 0, (uint32_t)(pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)        trace_record(TRACE_QUEUE_RECEIVE, 1, (uint32_t)(pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED(pxQueue) trace_record(TRACE_QUEUE_RECEIVE_FAILED, 1, (uint32_t)(pxQueue))
+
+#endif
+#endif
@@ -0,0 +1,147 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "stm32f4xx.h"
+#include "stm32rtos.h"
+#include "queue.h"
+#include "gpio.h"
+#include "clock.h"
+#include "power.h"
+#include "system.h"
+#include "uart.h"
+
+/* max. time to send one character (10 bits at 115200 baud = 87us) */
+#define UART_TX_TIMEOUT_US  200
+
+/* Queue used to pass the received characters to the console. */
+QueueHandle_t uart_rx_queue = NULL;
+
+volatile uint32_t uart_rx_dropped = 0;
+volatile uint32_t uart_rx_overruns = 0;
+
+/* the receiver is not clocked in STOP: a falling edge on RX wakes the MCU and holds a
+   STOP lock until the console releases it (the first character is lost) */
+static volatile uint32_t uart_wake_locked = 0;
+
+/* TX and RX on AF7, RX pulled up so that a floating line does not wake the MCU */
+static const gpio_pinset_t uart_pins[] = {
+    GPIO_PINSET_AF(GPIOA, GPIO_ODR_OD9,  7U, GPIO_OTYPE_PUSH_PULL, GPIO_SPEED_LOW, GPIO_PULL_NONE),
+    GPIO_PINSET_AF(GPIOA, GPIO_ODR_OD10, 7U, GPIO_OTYPE_PUSH_PULL, GPIO_SPEED_LOW, GPIO_PULL_UP)
+};
+
+void uart_init()
+{
+    gpio_apply(&uart_pins[0]);
+    gpio_apply(&uart_pins[1]);
+
+    /* baud rate from the APB2 clock (follows the clock profile) */
+    uart_clock_changed(clock_get_info());
+    clock_register_listener(uart_clock_changed);
+
+    /* 8N1, oversampling by 16, receive interupt */
+    MODIFY_REG(USART1->CR1, USART_CR1_M_Msk | USART_CR1_PCE_Msk | USART_CR1_OVER8_Msk, 0);
+    MODIFY_REG(USART1->CR2, USART_CR2_STOP_Msk, 0);
+    MODIFY_REG(USART1->CR1, USART_CR1_RXNEIE_Msk, USART_CR1_RXNEIE);
+    MODIFY_REG(USART1->CR1, USART_CR1_TE_Msk | USART_CR1_RE_Msk, USART_CR1_TE | USART_CR1_RE);
+    MODIFY_REG(USART1->CR1, USART_CR1_UE_Msk, USART_CR1_UE);
+
+    /* wake up from STOP on the falling edge of the start bit (EXTI10 <- PA10) */
+    MODIFY_REG(SYSCFG->EXTICR[2], SYSCFG_EXTICR3_EXTI10_Msk, SYSCFG_EXTICR3_EXTI10_PA);
+    SET_BIT(EXTI->FTSR, EXTI_FTSR_TR10);
+    SET_BIT(EXTI->IMR, EXTI_IMR_MR10);
+}
+
+/**
+ * clock listener: keep the baud rate for the new APB2 clock
+ */
+void uart_clock_changed(const clock_info_t *info)
+{
+    USART1->BRR = (info->pclk2_hz + (UART_BAUDRATE / 2)) / UART_BAUDRATE;
+}
+
+/**
+ * send a string (blocking, polls the transmitter)
+ */
+void uart_write_str(const char *str)
+{
+    while (*str) {
+        if (!system_wait(&USART1->SR, USART_SR_TXE_Msk, USART_SR_TXE, UART_TX_TIMEOUT_US)) {
+            return;
+        }
+        USART1->DR = (uint8_t)*str++;
+    }
+
+    /* the last character has to leave before the clocks may be stopped */
+    system_wait(&USART1->SR, USART_SR_TC_Msk, USART_SR_TC, UART_TX_TIMEOUT_US);
+}
+
+/**
+ * the console is idle: allow the STOP mode again and re-arm the RX wake up
+ */
+void uart_release_wake()
+{
+    if (uart_wake_locked) {
+        uart_wake_locked = 0;
+        SET_BIT(EXTI->IMR, EXTI_IMR_MR10);
+        power_stop_unlock();
+    }
+}
+
+void uart_isr_handler()
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t sr = USART1->SR;
+
+    if (sr & (USART_SR_RXNE_Msk | USART_SR_ORE_Msk)) {
+        /* reading DR clears RXNE and (after the SR read) the overrun; on an overrun DR
+           still holds a valid character, the one that arrived after it is lost */
+        char c = (char)USART1->DR;
+        if (sr & USART_SR_ORE_Msk) {
+            uart_rx_overruns++;
+        }
+        if (xQueueSendFromISR(uart_rx_queue, &c, &xHigherPriorityTaskWoken) != pdPASS) {
+            uart_rx_dropped++;
+        }
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void uart_wake_isr_handler()
+{
+    if (EXTI->PR & EXTI_PR_PR10_Msk) {
+        /* rc_w1 */
+        EXTI->PR = EXTI_PR_PR10;
+
+        /* one lock per session: mask the line until the console is idle again */
+        CLEAR_BIT(EXTI->IMR, EXTI_IMR_MR10);
+        if (!uart_wake_locked) {
+            uart_wake_locked = 1;
+            power_stop_lock_from_isr();
+        }
+    }
+}
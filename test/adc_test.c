@@ -0,0 +1,160 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "test.h"
+#include "stm32f4xx.h"
+#include "clock.h"
+#include "acq.h"
+#include "adc.h"
+
+/*
+    Host test of the ADC clock handling: the prescaler and the sample period used
+    for the block time stamps have to follow every clock profile switch (through
+    the clock listener) and every change of the sampling time.
+*/
+
+uint32_t host_register_rmw = 0;
+GPIO_TypeDef host_gpio[3];
+ADC_TypeDef host_adc1;
+ADC_Common_TypeDef host_adc_common;
+
+/* clock module stand-in */
+static clock_info_t clock_info;
+static clock_listener_t clock_listener = NULL;
+
+const clock_info_t *clock_get_info()
+{
+    return &clock_info;
+}
+
+void clock_register_listener(const clock_listener_t listener)
+{
+    clock_listener = listener;
+}
+
+void delay_us(const uint32_t us)
+{
+    (void)us;
+}
+
+static void switch_profile(const clock_profile_id_t id)
+{
+    CHECK_EQ(clock_profile_check(&clock_profiles[id], &clock_info), CLOCK_OK);
+    clock_info.id = id;
+    if (clock_listener != NULL) {
+        clock_listener(&clock_info);
+    }
+}
+
+/* period in us computed in floating point */
+static double period_us(const uint32_t sample_cycles, const uint32_t adc_hz)
+{
+    return ((double)(sample_cycles + ACQ_CONVERSION_CYCLES) * 1e6) / adc_hz;
+}
+
+static void check_period(const uint32_t sample_cycles)
+{
+    double expected = period_us(sample_cycles, clock_info.adc_hz);
+    double actual = adc_sample_period_q16() / 65536.0;
+
+    /* truncated Q16.16: at most one LSB below the exact value */
+    CHECK((actual <= expected) && (actual > (expected - (1.0 / 65536.0))));
+    CHECK_EQ(((ADC1_COMMON->CCR & ADC_CCR_ADCPRE_Msk) >> ADC_CCR_ADCPRE_Pos), (clock_info.adc_prescaler / 2) - 1);
+}
+
+static void test_init()
+{
+    switch_profile(CLOCK_PROFILE_HSI);
+    adc_init();
+
+    CHECK(clock_listener == adc_clock_changed);
+    check_period(ACQ_SAMPLE_CYCLES);
+}
+
+static void test_profile_switch()
+{
+    /* every profile, in both directions */
+    static const clock_profile_id_t order[] = {
+        CLOCK_PROFILE_PERFORMANCE, CLOCK_PROFILE_LOW, CLOCK_PROFILE_BALANCED,
+        CLOCK_PROFILE_HSI, CLOCK_PROFILE_PERFORMANCE
+    };
+
+    for (uint32_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        switch_profile(order[i]);
+        check_period(ACQ_SAMPLE_CYCLES);
+    }
+
+    /* 480 + 12 cycles at 6MHz: 82us */
+    switch_profile(CLOCK_PROFILE_PERFORMANCE);
+    CHECK_EQ(adc_sample_period_q16(), 82 << 16);
+}
+
+static void test_sample_time()
+{
+    acq_config_t config = acq_default_config;
+    acq_derived_t derived;
+
+    switch_profile(CLOCK_PROFILE_LOW);
+    config.sample_cycles = 15;
+    acq_derive(&config, 1, &derived);
+    adc_configure(&config, &derived);
+    check_period(15);
+    CHECK_EQ(ADC1->SMPR2 & (ADC_SMPR2_SMP0_Msk << (3 * config.channel)), 1U << (3 * config.channel));
+
+    /* the sampling time is kept over a clock switch */
+    switch_profile(CLOCK_PROFILE_HSI);
+    check_period(15);
+
+    config.sample_cycles = ACQ_SAMPLE_CYCLES;
+    acq_derive(&config, 1, &derived);
+    adc_configure(&config, &derived);
+    check_period(ACQ_SAMPLE_CYCLES);
+}
+
+static void test_period_and_rate()
+{
+    /* the period is the inverse of the sample rate used by the configuration check */
+    for (int id = 0; id < CLOCK_PROFILE_COUNT; id++) {
+        clock_info_t info;
+        CHECK_EQ(clock_profile_check(&clock_profiles[id], &info), CLOCK_OK);
+
+        uint32_t rate = acq_sample_rate(&acq_default_config, info.adc_hz);
+        double period = acq_sample_period_q16(ACQ_SAMPLE_CYCLES, info.adc_hz) / 65536.0;
+        CHECK((period * rate) <= 1e6);
+        CHECK((period * (rate + 1)) > 1e6);
+    }
+}
+
+int main()
+{
+    TEST_RUN(test_init);
+    TEST_RUN(test_profile_switch);
+    TEST_RUN(test_sample_time);
+    TEST_RUN(test_period_and_rate);
+
+    return test_result("adc_test");
+}
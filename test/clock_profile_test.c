@@ -0,0 +1,208 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "test.h"
+#include "clock_profile.h"
+
+/*
+    Host test of the clock profile table and of the PLL / voltage scale / wait
+    state validation (RM0383 / DS10314 limits).
+*/
+
+typedef struct expected_t {
+    clock_profile_id_t id;
+    uint32_t hclk_hz;
+    uint32_t pclk1_hz;
+    uint32_t pclk2_hz;
+    uint32_t tim_apb1_hz;
+    uint32_t flash_latency;
+    uint32_t adc_prescaler;
+    uint32_t adc_hz;
+} expected_t;
+
+static const expected_t expected[] = {
+    { CLOCK_PROFILE_PERFORMANCE, 96000000, 48000000, 48000000, 96000000, 3, 8, 6000000 },
+    { CLOCK_PROFILE_BALANCED,    48000000, 48000000, 48000000, 48000000, 1, 8, 6000000 },
+    { CLOCK_PROFILE_LOW,         25000000, 25000000, 25000000, 25000000, 0, 6, 4166666 },
+    { CLOCK_PROFILE_HSI,         16000000, 16000000, 16000000, 16000000, 0, 4, 4000000 },
+};
+
+static void test_table()
+{
+    uint32_t adc_min_hz = UINT32_MAX;
+
+    CHECK_EQ(sizeof(expected) / sizeof(expected[0]), CLOCK_PROFILE_COUNT);
+
+    for (uint32_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        clock_info_t info;
+        const expected_t *e = &expected[i];
+
+        CHECK_EQ(clock_profile_check(&clock_profiles[e->id], &info), CLOCK_OK);
+        CHECK_EQ(info.hclk_hz, e->hclk_hz);
+        CHECK_EQ(info.pclk1_hz, e->pclk1_hz);
+        CHECK_EQ(info.pclk2_hz, e->pclk2_hz);
+        CHECK_EQ(info.tim_apb1_hz, e->tim_apb1_hz);
+        CHECK_EQ(info.flash_latency, e->flash_latency);
+        CHECK_EQ(info.adc_prescaler, e->adc_prescaler);
+        CHECK_EQ(info.adc_hz, e->adc_hz);
+        CHECK(info.adc_hz <= CLOCK_ADC_TARGET_HZ);
+        CHECK(clock_profiles[e->id].name != NULL);
+        if (info.adc_hz < adc_min_hz) {
+            adc_min_hz = info.adc_hz;
+        }
+    }
+
+    /* the compile time check of the build configuration (acq.c) uses the slowest one */
+    CHECK_EQ(adc_min_hz, CLOCK_ADC_MIN_HZ);
+}
+
+static clock_error_t check_pll(uint32_t m, uint32_t n, uint32_t p, uint32_t vos, clock_info_t *info)
+{
+    /* APB2/4 keeps a valid ADC prescaler up to 100MHz */
+    const clock_profile_t profile = { "test", CLOCK_SOURCE_PLL, m, n, p, 4, 1, 2, 4, vos };
+    return clock_profile_check(&profile, info);
+}
+
+/* the clock module starts with CLOCK_INFO_HSI: it has to be what the table gives */
+static void test_boot_info()
+{
+    const clock_info_t boot = CLOCK_INFO_HSI;
+    clock_info_t info;
+
+    CHECK_EQ(clock_profile_check(&clock_profiles[CLOCK_PROFILE_HSI], &info), CLOCK_OK);
+    info.id = CLOCK_PROFILE_HSI;
+    CHECK_EQ(boot.id, info.id);
+    CHECK_EQ(boot.sysclk_hz, info.sysclk_hz);
+    CHECK_EQ(boot.hclk_hz, info.hclk_hz);
+    CHECK_EQ(boot.pclk1_hz, info.pclk1_hz);
+    CHECK_EQ(boot.pclk2_hz, info.pclk2_hz);
+    CHECK_EQ(boot.tim_apb1_hz, info.tim_apb1_hz);
+    CHECK_EQ(boot.tim_apb2_hz, info.tim_apb2_hz);
+    CHECK_EQ(boot.flash_latency, info.flash_latency);
+    CHECK_EQ(boot.adc_prescaler, info.adc_prescaler);
+    CHECK_EQ(boot.adc_hz, info.adc_hz);
+}
+
+static void test_pll()
+{
+    clock_info_t info;
+
+    /* divider ranges */
+    CHECK_EQ(check_pll(1, 192, 2, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+    CHECK_EQ(check_pll(64, 192, 2, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+    CHECK_EQ(check_pll(25, 49, 2, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+    CHECK_EQ(check_pll(25, 433, 2, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+    CHECK_EQ(check_pll(25, 192, 3, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+    CHECK_EQ(check_pll(25, 192, 10, 1, &info), CLOCK_ERROR_PLL_DIVIDER);
+
+    /* VCO input 1..2MHz */
+    CHECK_EQ(check_pll(26, 192, 2, 1, &info), CLOCK_ERROR_PLL_INPUT);
+    CHECK_EQ(check_pll(12, 192, 2, 1, &info), CLOCK_ERROR_PLL_INPUT);
+    CHECK_EQ(check_pll(13, 192, 4, 1, &info), CLOCK_OK);
+
+    /* VCO output 100..432MHz */
+    CHECK_EQ(check_pll(25, 99, 2, 1, &info), CLOCK_ERROR_PLL_VCO);
+    CHECK_EQ(check_pll(25, 100, 2, 1, &info), CLOCK_OK);
+    CHECK_EQ(check_pll(13, 432, 8, 1, &info), CLOCK_ERROR_PLL_VCO);
+}
+
+static void test_voltage_scale()
+{
+    clock_info_t info;
+
+    /* scale 1: 100MHz, scale 2: 84MHz, scale 3: 64MHz */
+    CHECK_EQ(check_pll(25, 200, 2, 1, &info), CLOCK_OK);
+    CHECK_EQ(check_pll(25, 204, 2, 1, &info), CLOCK_ERROR_HCLK);
+    CHECK_EQ(check_pll(25, 168, 2, 2, &info), CLOCK_OK);
+    CHECK_EQ(check_pll(25, 172, 2, 2, &info), CLOCK_ERROR_HCLK);
+    CHECK_EQ(check_pll(25, 256, 4, 3, &info), CLOCK_OK);
+    CHECK_EQ(check_pll(25, 264, 4, 3, &info), CLOCK_ERROR_HCLK);
+    CHECK_EQ(check_pll(25, 192, 2, 0, &info), CLOCK_ERROR_HCLK);
+    CHECK_EQ(check_pll(25, 192, 2, 4, &info), CLOCK_ERROR_HCLK);
+}
+
+static void test_wait_states()
+{
+    clock_info_t info;
+
+    /* 0WS up to 30MHz, 1WS up to 64MHz, 2WS up to 90MHz, 3WS up to 100MHz */
+    static const struct { uint32_t n, p, latency; } steps[] = {
+        { 240, 8, 0 },  /* 30MHz */
+        { 248, 8, 1 },  /* 31MHz */
+        { 256, 4, 1 },  /* 64MHz */
+        { 264, 4, 2 },  /* 66MHz */
+        { 180, 2, 2 },  /* 90MHz */
+        { 184, 2, 3 },  /* 92MHz */
+        { 200, 2, 3 },  /* 100MHz */
+    };
+
+    for (uint32_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        CHECK_EQ(check_pll(25, steps[i].n, steps[i].p, 1, &info), CLOCK_OK);
+        CHECK_EQ(info.flash_latency, steps[i].latency);
+    }
+}
+
+static void test_bus()
+{
+    clock_info_t info;
+    clock_profile_t profile = clock_profiles[CLOCK_PROFILE_PERFORMANCE];
+
+    /* there is no AHB/32 */
+    profile.hpre = 32;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_ERROR_BUS_DIVIDER);
+    profile.hpre = 64;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_OK);
+    CHECK_EQ(info.hclk_hz, 1500000);
+
+    profile = clock_profiles[CLOCK_PROFILE_PERFORMANCE];
+    profile.ppre1 = 3;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_ERROR_BUS_DIVIDER);
+    profile.ppre1 = 32;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_ERROR_BUS_DIVIDER);
+
+    /* APB1 is limited to 50MHz */
+    profile = clock_profiles[CLOCK_PROFILE_PERFORMANCE];
+    profile.ppre1 = 1;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_ERROR_PCLK1);
+
+    /* APB2 at 96MHz: even /8 is above the ADC target */
+    profile = clock_profiles[CLOCK_PROFILE_PERFORMANCE];
+    profile.ppre2 = 1;
+    CHECK_EQ(clock_profile_check(&profile, &info), CLOCK_ERROR_ADC);
+}
+
+int main()
+{
+    TEST_RUN(test_table);
+    TEST_RUN(test_boot_info);
+    TEST_RUN(test_pll);
+    TEST_RUN(test_voltage_scale);
+    TEST_RUN(test_wait_states);
+    TEST_RUN(test_bus);
+
+    return test_result("clock_profile_test");
+}
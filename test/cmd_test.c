@@ -0,0 +1,204 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "test.h"
+#include "clock_profile.h"
+#include "acq.h"
+#include "cmd.h"
+
+/*
+    Host test of the console protocol: every configuration written as a set line
+    (the way scripts/adc-cli.py sends it) parses back to the same configuration,
+    malformed lines are rejected without touching the configuration, and
+    acq_config_check accepts or refuses a configuration for the ADC clock of every
+    profile (the check done before a profile switch).
+*/
+
+static const acq_config_t other_config = { 2000, 2, 500, 9, 144 };
+
+static cmd_error_t parse(const char *text, cmd_id_t *id, acq_config_t *config)
+{
+    char line[CMD_LINE_MAX + 1];
+
+    strncpy(line, text, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    return cmd_parse(line, id, config);
+}
+
+static uint32_t same_config(const acq_config_t *a, const acq_config_t *b)
+{
+    return (a->block_size == b->block_size) && (a->burst_blocks == b->burst_blocks) && (a->period_ms == b->period_ms) &&
+           (a->channel == b->channel) && (a->sample_cycles == b->sample_cycles);
+}
+
+static uint32_t profile_adc_hz(const clock_profile_id_t id)
+{
+    clock_info_t info;
+
+    CHECK_EQ(clock_profile_check(&clock_profiles[id], &info), CLOCK_OK);
+    return info.adc_hz;
+}
+
+static void test_commands()
+{
+    static const struct { const char *line; cmd_id_t id; } commands[] = {
+        { "status",         CMD_STATUS },
+        { "stop",           CMD_STOP },
+        { "start\r",        CMD_START },
+        { "  defaults  ",   CMD_DEFAULTS },
+        { "trace",          CMD_TRACE },
+        { "bus",            CMD_BUS },
+        { "\tview",         CMD_VIEW },
+        { "help",           CMD_HELP },
+        { "",               CMD_NONE },
+        { "   ",            CMD_NONE },
+    };
+
+    for (uint32_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        acq_config_t config = acq_default_config;
+        cmd_id_t id;
+        CHECK_EQ(parse(commands[i].line, &id, &config), CMD_OK);
+        CHECK_EQ(id, commands[i].id);
+        CHECK(same_config(&config, &acq_default_config));
+    }
+}
+
+/* configuration -> set line -> parser -> configuration */
+static void test_loopback()
+{
+    static const acq_config_t configs[] = {
+        { ACQ_BLOCK_SIZE, ACQ_BURST_BLOCKS, ACQ_PERIOD_MS, ACQ_CHANNEL, ACQ_SAMPLE_CYCLES },
+        { 2000, 2, 500, 9, 144 },
+        { 8, 1, 10, 8, 3 },
+        { ACQ_POOL_SAMPLES / 2, 100, 999999999, 9, 480 },
+    };
+
+    for (uint32_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        char line[CMD_LINE_MAX + 1];
+        acq_config_t config = (i == 1) ? acq_default_config : other_config;
+        cmd_id_t id;
+
+        int length = snprintf(line, sizeof(line), "set block=%u burst=%u period=%u channel=%u smp=%u",
+            configs[i].block_size, configs[i].burst_blocks, configs[i].period_ms, configs[i].channel, configs[i].sample_cycles);
+        CHECK(length <= CMD_LINE_MAX);
+        CHECK_EQ(cmd_parse(line, &id, &config), CMD_OK);
+        CHECK_EQ(id, CMD_SET);
+        CHECK(same_config(&config, &configs[i]));
+    }
+
+    /* a partial set keeps the other fields */
+    acq_config_t config = acq_default_config;
+    cmd_id_t id;
+    CHECK_EQ(parse("set smp=144 period=500", &id, &config), CMD_OK);
+    CHECK_EQ(config.sample_cycles, 144);
+    CHECK_EQ(config.period_ms, 500);
+    CHECK_EQ(config.block_size, ACQ_BLOCK_SIZE);
+    CHECK_EQ(config.channel, ACQ_CHANNEL);
+}
+
+/* a bad line leaves the configuration as it was (no half applied set) */
+static void test_errors()
+{
+    static const struct { const char *line; cmd_error_t error; } errors[] = {
+        { "reboot",                     CMD_ERROR_COMMAND },
+        { "STATUS",                     CMD_ERROR_COMMAND },
+        { "set rate=100",               CMD_ERROR_KEY },
+        { "set block=2000 rate=100",    CMD_ERROR_KEY },
+        { "set block=12a",              CMD_ERROR_VALUE },
+        { "set block=-8",               CMD_ERROR_VALUE },
+        { "set block=+8",               CMD_ERROR_VALUE },
+        { "set period=1234567890",      CMD_ERROR_VALUE },
+        { "set block=2000 smp=x",       CMD_ERROR_VALUE },
+        { "set",                        CMD_ERROR_SYNTAX },
+        { "set block",                  CMD_ERROR_SYNTAX },
+        { "set block=",                 CMD_ERROR_SYNTAX },
+        { "set =8",                     CMD_ERROR_SYNTAX },
+        { "status now",                 CMD_ERROR_SYNTAX },
+    };
+
+    for (uint32_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+        acq_config_t config = acq_default_config;
+        cmd_id_t id;
+        cmd_error_t error = parse(errors[i].line, &id, &config);
+        if (error != errors[i].error) {
+            printf("    \"%s\"\n", errors[i].line);
+        }
+        CHECK_EQ(error, errors[i].error);
+        CHECK(same_config(&config, &acq_default_config));
+        CHECK(strcmp(cmd_error_str(error), "?") != 0);
+    }
+}
+
+static void test_config_check()
+{
+    const uint32_t adc_hz = CLOCK_ADC_TARGET_HZ;
+    static const struct { acq_config_t config; acq_error_t error; } checks[] = {
+        { { 1000, 1, 250, 8, 480 },                     ACQ_OK },
+        { { 0, 1, 250, 8, 480 },                        ACQ_ERROR_BLOCK_SIZE },
+        { { 1004, 1, 250, 8, 480 },                     ACQ_ERROR_BLOCK_SIZE },
+        { { ACQ_POOL_SAMPLES / 2 + 8, 1, 1000, 8, 480 }, ACQ_ERROR_BLOCK_SIZE },
+        { { 1000, 0, 250, 8, 480 },                     ACQ_ERROR_BURST },
+        { { 8, 1, 9, 8, 480 },                          ACQ_ERROR_PERIOD },
+        { { 1000, 1, 250, 7, 480 },                     ACQ_ERROR_CHANNEL },
+        { { 1000, 1, 250, 8, 100 },                     ACQ_ERROR_SAMPLE_TIME },
+        /* 6MHz / 492 cycles = 12195 samples/s: 3048 per 250ms */
+        { { 3056, 1, 250, 8, 480 },                     ACQ_ERROR_RATE },
+        { { 3048, 1, 250, 8, 480 },                     ACQ_OK },
+        { { 1024, 3, 250, 8, 480 },                     ACQ_ERROR_RATE },
+        { { 1016, 3, 250, 8, 480 },                     ACQ_OK },
+    };
+
+    for (uint32_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        CHECK_EQ(acq_config_check(&checks[i].config, adc_hz), checks[i].error);
+        CHECK(strcmp(cmd_acq_error_str(checks[i].error), "?") != 0);
+    }
+}
+
+/* what a profile switch has to recheck: a burst that fits the 6MHz ADC clock of the
+   sampling profiles does not fit the slower clocks of the LOW and HSI profiles */
+static void test_config_per_profile()
+{
+    const acq_config_t tight = { 2400, 1, 250, 8, 480 };
+
+    for (clock_profile_id_t id = 0; id < CLOCK_PROFILE_COUNT; id++) {
+        CHECK_EQ(acq_config_check(&acq_default_config, profile_adc_hz(id)), ACQ_OK);
+    }
+    CHECK_EQ(acq_config_check(&tight, profile_adc_hz(CLOCK_PROFILE_PERFORMANCE)), ACQ_OK);
+    CHECK_EQ(acq_config_check(&tight, profile_adc_hz(CLOCK_PROFILE_BALANCED)), ACQ_OK);
+    CHECK_EQ(acq_config_check(&tight, profile_adc_hz(CLOCK_PROFILE_LOW)), ACQ_ERROR_RATE);
+    CHECK_EQ(acq_config_check(&tight, profile_adc_hz(CLOCK_PROFILE_HSI)), ACQ_ERROR_RATE);
+}
+
+int main()
+{
+    TEST_RUN(test_commands);
+    TEST_RUN(test_loopback);
+    TEST_RUN(test_errors);
+    TEST_RUN(test_config_check);
+    TEST_RUN(test_config_per_profile);
+    return test_result("cmd_test");
+}
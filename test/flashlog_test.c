@@ -0,0 +1,363 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <setjmp.h>
+#include "test.h"
+#include "stm32rtos.h"
+#include "task.h"
+#include "queue.h"
+#include "bus.h"
+#include "flashlog.h"
+#include "flash_sim.h"
+
+/*
+    Host test of the measurement log on simulated flash: no erase before the first
+    commit, rotation through the sectors, resume after a reset and recovery from a
+    power loss in the middle of a record and of a sector header. vTaskLog runs until
+    the test has no more blocks for it (one run is one boot).
+*/
+
+#define SECTOR_SIZE     1024
+#define SECTOR_RECORDS  ((SECTOR_SIZE - sizeof(flashlog_header_t)) / sizeof(flashlog_record_t))
+
+/* bus stand-in: hands out generated blocks, leaves vTaskLog when there are no more */
+static bus_subscriber_t subscriber = { .name = "log" };
+static bus_block_t block;
+static uint32_t block_sequence = 0;
+static uint32_t blocks_left = 0;
+static jmp_buf log_exit;
+
+/* set while the sampler task runs flashlog_sampler_parked (the only place to erase) */
+static uint32_t parked = 0;
+static uint32_t erase_waits = 0;
+static uint32_t erases_unparked = 0;
+
+bus_subscriber_t *bus_subscribe(const char *name, const bus_mode_t mode, const uint32_t depth)
+{
+    (void)name;
+    subscriber.mode = mode;
+    CHECK(mode == BUS_MODE_LOSSLESS);
+    CHECK(depth >= FLASHLOG_DEPTH);
+    return &subscriber;
+}
+
+const bus_block_t *bus_receive(bus_subscriber_t *s, const TickType_t timeout)
+{
+    (void)s;
+    (void)timeout;
+
+    if (blocks_left == 0) {
+        longjmp(log_exit, 1);
+    }
+    blocks_left--;
+
+    block.sequence = block_sequence;
+    block.digital_value = block_sequence * 7;
+    block.length = 100;
+    block.timestamp_us = (uint64_t)block_sequence * 10000;
+    block.sample_index = (uint64_t)block_sequence * 100;
+    block_sequence++;
+    return &block;
+}
+
+void bus_release(const bus_block_t *b)
+{
+    (void)b;
+}
+
+/* system and trace stand-ins (a failed subscribe is a test failure) */
+void trace_record(const uint8_t id, const uint8_t arg, const uint32_t data)
+{
+    (void)id;
+    (void)arg;
+    (void)data;
+}
+
+void trace_stop()
+{
+}
+
+void blink(const uint8_t n)
+{
+    CHECK_EQ(n, 0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return (TaskHandle_t)&subscriber;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout)
+{
+    (void)clear_on_exit;
+    (void)timeout;
+
+    /* the log task waits for the erase: the sampler parks and runs it */
+    erase_waits++;
+    parked = 1;
+    CHECK_EQ(flashlog_sampler_parked(), 1);
+    parked = 0;
+    return 1;
+}
+
+static uint32_t erase_sector(const uint32_t sector)
+{
+    if (!parked) {
+        erases_unparked++;
+    }
+    return flash_sim_erase_sector(sector);
+}
+
+static const flashlog_hw_control_t hw = {
+    .sector_address = flash_sim_sector_address,
+    .sector_size    = flash_sim_sector_size,
+    .erase_sector   = erase_sector,
+    .program_word   = flash_sim_program_word
+};
+
+/* one boot: init and log the given number of blocks */
+static void run_log(const uint32_t blocks)
+{
+    flashlog_init(hw);
+    blocks_left = blocks;
+    if (setjmp(log_exit) == 0) {
+        vTaskLog(NULL);
+    }
+}
+
+static void fresh_flash()
+{
+    flash_sim_init(FLASHLOG_SECTOR_FIRST, FLASHLOG_SECTOR_COUNT, SECTOR_SIZE);
+    memset(&flashlog_stats, 0, sizeof(flashlog_stats));
+    block_sequence = 0;
+    erase_waits = 0;
+    erases_unparked = 0;
+}
+
+/* reader: what scripts/flashlog-read.py gets from a dump of the sector */
+typedef struct sector_t {
+    flashlog_header_t header;
+    flashlog_record_t records[SECTOR_RECORDS];
+    uint32_t count;
+    uint32_t corrupted;
+} sector_t;
+
+static uint8_t crc8(const uint8_t *data, const uint32_t length)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void read_sector(const uint32_t sector, sector_t *result)
+{
+    const uint8_t *base = (const uint8_t *)(uintptr_t)flash_sim_sector_address(FLASHLOG_SECTOR_FIRST + sector);
+    static const uint8_t empty[sizeof(flashlog_record_t)] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+
+    memset(result, 0, sizeof(sector_t));
+    memcpy(&result->header, base, sizeof(flashlog_header_t));
+    for (uint32_t offset = sizeof(flashlog_header_t); offset + sizeof(flashlog_record_t) <= SECTOR_SIZE; offset += sizeof(flashlog_record_t)) {
+        if (memcmp(base + offset, empty, sizeof(empty)) == 0) {
+            break;
+        }
+        if (crc8(base + offset, sizeof(flashlog_record_t) - 1) != base[offset + sizeof(flashlog_record_t) - 1]) {
+            result->corrupted++;
+            continue;
+        }
+        memcpy(&result->records[result->count++], base + offset, sizeof(flashlog_record_t));
+    }
+}
+
+static void test_init_does_not_erase()
+{
+    fresh_flash();
+    flashlog_init(hw);
+    CHECK_EQ(flash_sim_erases, 0);
+    CHECK_EQ(flash_sim_programs, 0);
+    CHECK_EQ(flashlog_stats.erases, 0);
+
+    /* nothing requested: the sampler goes on with the next window */
+    CHECK_EQ(flashlog_sampler_parked(), 0);
+    CHECK_EQ(flash_sim_erases, 0);
+}
+
+static void test_first_commit()
+{
+    sector_t s;
+
+    fresh_flash();
+    run_log(FLASHLOG_BATCH);
+
+    /* the first sector is erased by the parked sampler, then started by the log task */
+    CHECK_EQ(flash_sim_erases, 1);
+    CHECK_EQ(erase_waits, 1);
+    CHECK_EQ(erases_unparked, 0);
+    CHECK_EQ(flashlog_stats.records, FLASHLOG_BATCH);
+    CHECK_EQ(flashlog_stats.errors, 0);
+
+    read_sector(0, &s);
+    CHECK_EQ(s.header.magic, FLASHLOG_MAGIC);
+    CHECK_EQ(s.header.sequence, 1);
+    CHECK_EQ(s.header.erase_count, 1);
+    CHECK_EQ(s.count, FLASHLOG_BATCH);
+    CHECK_EQ(s.corrupted, 0);
+    CHECK_EQ(s.records[0].flags, FLASHLOG_FLAG_BOOT);
+    CHECK_EQ(s.records[1].flags, 0);
+    for (uint32_t i = 0; i < s.count; i++) {
+        CHECK_EQ(s.records[i].sequence, i);
+        CHECK_EQ(s.records[i].digital_value, i * 7);
+        CHECK_EQ(s.records[i].timestamp_ms, i * 10);
+        CHECK_EQ(s.records[i].length, 100);
+    }
+
+    read_sector(1, &s);
+    CHECK_EQ(s.header.magic, 0xFFFFFFFF);
+}
+
+static void test_resume_after_reset()
+{
+    sector_t s;
+
+    fresh_flash();
+    run_log(FLASHLOG_BATCH);
+    run_log(FLASHLOG_BATCH);
+
+    /* appended to the same sector, without an erase */
+    CHECK_EQ(flash_sim_erases, 1);
+    read_sector(0, &s);
+    CHECK_EQ(s.header.sequence, 1);
+    CHECK_EQ(s.count, 2 * FLASHLOG_BATCH);
+    CHECK_EQ(s.records[FLASHLOG_BATCH].sequence, FLASHLOG_BATCH);
+    CHECK(s.records[FLASHLOG_BATCH].flags & FLASHLOG_FLAG_BOOT);
+}
+
+static void test_rotation()
+{
+    sector_t s0, s1;
+    const uint32_t blocks = 10 * FLASHLOG_BATCH;
+
+    fresh_flash();
+    run_log(blocks);
+
+    /* sector 0, sector 1, sector 0 again (the oldest records are gone) */
+    CHECK_EQ(flash_sim_erases, 3);
+    CHECK_EQ(erase_waits, 3);
+    CHECK_EQ(erases_unparked, 0);
+    CHECK_EQ(flashlog_stats.records, blocks);
+
+    read_sector(0, &s0);
+    read_sector(1, &s1);
+    CHECK_EQ(s0.header.sequence, 3);
+    CHECK_EQ(s0.header.erase_count, 2);
+    CHECK_EQ(s1.header.sequence, 2);
+    CHECK_EQ(s1.header.erase_count, 1);
+    CHECK_EQ(s1.count, SECTOR_RECORDS);
+    CHECK_EQ(s1.records[0].sequence, SECTOR_RECORDS);
+    CHECK_EQ(s0.count, blocks - (2 * SECTOR_RECORDS));
+    CHECK_EQ(s0.records[0].sequence, 2 * SECTOR_RECORDS);
+
+    /* a reset continues in the newest sector */
+    run_log(FLASHLOG_BATCH);
+    CHECK_EQ(flash_sim_erases, 3);
+    read_sector(0, &s0);
+    CHECK_EQ(s0.count, blocks - (2 * SECTOR_RECORDS) + FLASHLOG_BATCH);
+}
+
+static void test_torn_record()
+{
+    sector_t s;
+
+    fresh_flash();
+    run_log(FLASHLOG_BATCH);
+
+    /* power loss after the first two words of the next record */
+    flash_sim_power_loss(2);
+    run_log(FLASHLOG_BATCH);
+    flash_sim_power_on();
+
+    /* the torn slot is skipped by the writer and by the reader */
+    run_log(FLASHLOG_BATCH);
+    read_sector(0, &s);
+    CHECK_EQ(s.corrupted, 1);
+    CHECK_EQ(s.count, 2 * FLASHLOG_BATCH);
+    CHECK_EQ(s.records[FLASHLOG_BATCH - 1].sequence, FLASHLOG_BATCH - 1);
+    CHECK_EQ(s.records[FLASHLOG_BATCH].sequence, 2 * FLASHLOG_BATCH);
+}
+
+static void test_torn_header()
+{
+    sector_t s0, s1;
+    const uint32_t header_words = sizeof(flashlog_header_t) / 4;
+    const uint32_t record_words = sizeof(flashlog_record_t) / 4;
+
+    fresh_flash();
+
+    /* power loss while the header of the second sector is written (before the magic) */
+    flash_sim_power_loss(header_words + (SECTOR_RECORDS * record_words) + header_words - 1);
+    run_log(4 * FLASHLOG_BATCH);
+    flash_sim_power_on();
+    CHECK_EQ(flash_sim_erases, 2);
+
+    /* the sector without the magic is not taken: the first one stays the active one */
+    run_log(FLASHLOG_BATCH);
+    CHECK_EQ(flash_sim_erases, 3);
+
+    read_sector(0, &s0);
+    read_sector(1, &s1);
+    CHECK_EQ(s0.header.sequence, 1);
+    CHECK_EQ(s0.count, SECTOR_RECORDS);
+    CHECK_EQ(s1.header.magic, FLASHLOG_MAGIC);
+    CHECK_EQ(s1.header.sequence, 2);
+    CHECK_EQ(s1.count, FLASHLOG_BATCH);
+    CHECK_EQ(s1.corrupted, 0);
+    CHECK_EQ(s1.records[0].sequence, 4 * FLASHLOG_BATCH);
+}
+
+int main()
+{
+    TEST_RUN(test_init_does_not_erase);
+    TEST_RUN(test_first_commit);
+    TEST_RUN(test_resume_after_reset);
+    TEST_RUN(test_rotation);
+    TEST_RUN(test_torn_record);
+    TEST_RUN(test_torn_header);
+    return test_result("flashlog_test");
+}
@@ -0,0 +1,85 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "bench.h"
+#include "gpio.h"
+#include "gpio_ref.h"
+
+/*
+    Bus turnaround of the LCD data bus (output then input) with the per pin
+    configuration of the baseline and with the folded pin sets: register
+    read-modify-writes (GPIO accesses on the target) and host time per turnaround.
+*/
+
+uint32_t host_register_rmw = 0;
+GPIO_TypeDef host_gpio[3];
+
+#define BENCH_TURNAROUNDS   1000000
+
+typedef struct result_t {
+    double rmw;
+    double ns;
+} result_t;
+
+static result_t bench(void (*out)(), void (*in)())
+{
+    result_t result = { 0, 1e30 };
+
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        host_register_rmw = 0;
+        uint64_t start = bench_now_ns();
+        for (uint32_t i = 0; i < BENCH_TURNAROUNDS; i++) {
+            out();
+            in();
+        }
+        double ns = (double)(bench_now_ns() - start) / BENCH_TURNAROUNDS;
+        result.rmw = (double)host_register_rmw / BENCH_TURNAROUNDS;
+        if (ns < result.ns) {
+            result.ns = ns;
+        }
+    }
+    return result;
+}
+
+int main()
+{
+    gpio_init();
+
+    result_t before = bench(gpio_ref_config_data_out, gpio_ref_config_data_in);
+    result_t after  = bench(gpio_config_data_out, gpio_config_data_in);
+
+    printf("gpio_bench: LCD bus turnaround (data out + data in)\n");
+    printf("  %-20s %8s %10s\n", "", "rmw", "ns");
+    printf("  %-20s %8.0f %10.2f\n", "per pin (before)", before.rmw, before.ns);
+    printf("  %-20s %8.0f %10.2f\n", "pin sets (after)", after.rmw, after.ns);
+
+    /* one access per direction change; at least twice as fast as the per pin code */
+    BENCH_LIMIT("rmw per turnaround", after.rmw, 2);
+    BENCH_LIMIT("ns per turnaround", after.ns, before.ns / 2);
+
+    return bench_result("gpio_bench");
+}
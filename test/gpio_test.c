@@ -0,0 +1,179 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "test.h"
+#include "gpio.h"
+#include "gpio_ref.h"
+
+/*
+    Host test of the folded GPIO pin sets: starting from random register contents,
+    the LCD call sequence (init, control out, data out/in turnarounds) must leave
+    the same register image as the per pin configuration of the baseline.
+    The pin sets configure output type, speed and pull of the data bus once in
+    gpio_init() instead of with every switch to output, so the image of PA0..PA7
+    is only compared once the bus was switched to output the first time.
+*/
+
+uint32_t host_register_rmw = 0;
+GPIO_TypeDef host_gpio[3];
+
+#define TEST_SEEDS          64
+#define TEST_DATA_PINS      0x00FFU
+#define TEST_DATA_FIELDS    0xFFFFU     /* 2 bit fields of PA0..PA7 */
+
+typedef enum step_t {
+    STEP_INIT,
+    STEP_CONTROL_OUT,
+    STEP_DATA_OUT,
+    STEP_DATA_IN,
+    STEP_DATA_OUT_AGAIN,
+    STEP_COUNT
+} step_t;
+
+static uint32_t lcg(uint32_t *state)
+{
+    *state = (*state * 1664525U) + 1013904223U;
+    return *state;
+}
+
+static void randomize(uint32_t seed)
+{
+    for (int p = 0; p < 3; p++) {
+        host_gpio[p].MODER   = lcg(&seed);
+        host_gpio[p].OTYPER  = lcg(&seed) & 0xFFFFU;
+        host_gpio[p].OSPEEDR = lcg(&seed);
+        host_gpio[p].PUPDR   = lcg(&seed);
+        host_gpio[p].ODR     = lcg(&seed) & 0xFFFFU;
+        host_gpio[p].AFR[0]  = lcg(&seed);
+        host_gpio[p].AFR[1]  = lcg(&seed);
+    }
+}
+
+static void run_ref(step_t step)
+{
+    switch (step) {
+        case STEP_INIT:             gpio_ref_init(); break;
+        case STEP_CONTROL_OUT:      gpio_ref_config_control_out(); break;
+        case STEP_DATA_IN:          gpio_ref_config_data_in(); break;
+        default:                    gpio_ref_config_data_out(); break;
+    }
+}
+
+static void run_new(step_t step)
+{
+    switch (step) {
+        case STEP_INIT:             gpio_init(); break;
+        case STEP_CONTROL_OUT:      gpio_config_control_out(); break;
+        case STEP_DATA_IN:          gpio_config_data_in(); break;
+        default:                    gpio_config_data_out(); break;
+    }
+}
+
+static void check_image(const GPIO_TypeDef *expected, const GPIO_TypeDef *actual, const int data_defined)
+{
+    for (int p = 0; p < 3; p++) {
+        uint32_t ignore1 = ((p == 0) && !data_defined) ? TEST_DATA_PINS : 0;
+        uint32_t ignore2 = ((p == 0) && !data_defined) ? TEST_DATA_FIELDS : 0;
+
+        CHECK_EQ(expected[p].MODER & ~ignore2, actual[p].MODER & ~ignore2);
+        CHECK_EQ(expected[p].OTYPER & ~ignore1, actual[p].OTYPER & ~ignore1);
+        CHECK_EQ(expected[p].OSPEEDR & ~ignore2, actual[p].OSPEEDR & ~ignore2);
+        CHECK_EQ(expected[p].PUPDR & ~ignore2, actual[p].PUPDR & ~ignore2);
+        CHECK_EQ(expected[p].ODR, actual[p].ODR);
+        CHECK_EQ(expected[p].AFR[0], actual[p].AFR[0]);
+        CHECK_EQ(expected[p].AFR[1], actual[p].AFR[1]);
+    }
+}
+
+static void test_register_image()
+{
+    for (uint32_t seed = 1; seed <= TEST_SEEDS; seed++) {
+        GPIO_TypeDef expected[STEP_COUNT][3];
+
+        randomize(seed);
+        for (int step = 0; step < STEP_COUNT; step++) {
+            run_ref((step_t)step);
+            memcpy(expected[step], host_gpio, sizeof(host_gpio));
+        }
+
+        randomize(seed);
+        for (int step = 0; step < STEP_COUNT; step++) {
+            run_new((step_t)step);
+            check_image(expected[step], host_gpio, step >= STEP_DATA_OUT);
+        }
+    }
+}
+
+static void test_data_bus_after_init()
+{
+    /* the data bus is an input with defined output settings right after the init */
+    randomize(7);
+    gpio_init();
+    CHECK_EQ(GPIOA->MODER & (TEST_DATA_FIELDS), 0);
+    CHECK_EQ(GPIOA->OTYPER & TEST_DATA_PINS, 0);
+    CHECK_EQ(GPIOA->OSPEEDR & (TEST_DATA_FIELDS), 0);
+    CHECK_EQ(GPIOA->PUPDR & (TEST_DATA_FIELDS), 0);
+}
+
+static void test_access_count()
+{
+    /* one read-modify-write per turnaround instead of one per pin and register */
+    host_register_rmw = 0;
+    gpio_config_data_out();
+    CHECK_EQ(host_register_rmw, 1);
+
+    host_register_rmw = 0;
+    gpio_config_data_in();
+    CHECK_EQ(host_register_rmw, 1);
+
+    host_register_rmw = 0;
+    gpio_ref_config_data_out();
+    CHECK_EQ(host_register_rmw, 32);
+
+    host_register_rmw = 0;
+    gpio_ref_config_data_in();
+    CHECK_EQ(host_register_rmw, 8);
+}
+
+static void test_led()
+{
+    GPIOC->BSRR = 0;
+    gpio_set_blue_led();
+    CHECK_EQ(GPIOC->BSRR, GPIO_BSRR_BR13);
+    gpio_reset_blue_led();
+    CHECK_EQ(GPIOC->BSRR, GPIO_BSRR_BS13);
+}
+
+int main()
+{
+    TEST_RUN(test_register_image);
+    TEST_RUN(test_data_bus_after_init);
+    TEST_RUN(test_access_count);
+    TEST_RUN(test_led);
+
+    return test_result("gpio_test");
+}
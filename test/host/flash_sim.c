@@ -0,0 +1,125 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "flash_sim.h"
+
+uint32_t flash_sim_erases = 0;
+uint32_t flash_sim_programs = 0;
+
+static uint8_t *memory = NULL;
+static uint32_t memory_first = 0;
+static uint32_t memory_count = 0;
+static uint32_t memory_sector_size = 0;
+
+/* program operations left before the power loss (0xFFFFFFFF: none pending) */
+static uint32_t power_left = 0xFFFFFFFF;
+
+void flash_sim_init(const uint32_t first_sector, const uint32_t count, const uint32_t sector_size)
+{
+    if (memory != NULL) {
+        munmap(memory, memory_count * memory_sector_size);
+    }
+
+    memory = mmap(NULL, count * sector_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("flash_sim_init");
+        exit(1);
+    }
+
+    memory_first = first_sector;
+    memory_count = count;
+    memory_sector_size = sector_size;
+    memset(memory, 0xFF, count * sector_size);
+
+    flash_sim_erases = 0;
+    flash_sim_programs = 0;
+    power_left = 0xFFFFFFFF;
+}
+
+void flash_sim_power_loss(const uint32_t programs)
+{
+    power_left = programs;
+}
+
+void flash_sim_power_on()
+{
+    power_left = 0xFFFFFFFF;
+}
+
+uint32_t flash_sim_sector_address(const uint32_t sector)
+{
+    return (uint32_t)(uintptr_t)(memory + ((sector - memory_first) * memory_sector_size));
+}
+
+uint32_t flash_sim_sector_size(const uint32_t sector)
+{
+    (void)sector;
+    return memory_sector_size;
+}
+
+uint32_t flash_sim_erase_sector(const uint32_t sector)
+{
+    if ((sector < memory_first) || (sector >= memory_first + memory_count)) {
+        return 0;
+    }
+
+    /* powered off: the caller does not notice */
+    if (power_left == 0) {
+        return 1;
+    }
+
+    memset(memory + ((sector - memory_first) * memory_sector_size), 0xFF, memory_sector_size);
+    flash_sim_erases++;
+    return 1;
+}
+
+uint32_t flash_sim_program_word(const uint32_t address, const uint32_t data)
+{
+    uint8_t *target = (uint8_t *)(uintptr_t)address;
+
+    if ((address & 3) || (target < memory) || (target + 4 > memory + (memory_count * memory_sector_size))) {
+        return 0;
+    }
+
+    if (power_left == 0) {
+        return 1;
+    }
+    if (power_left != 0xFFFFFFFF) {
+        power_left--;
+    }
+
+    uint32_t word;
+    memcpy(&word, target, 4);
+    word &= data;
+    memcpy(target, &word, 4);
+    flash_sim_programs++;
+    return 1;
+}
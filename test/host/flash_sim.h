@@ -0,0 +1,53 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/*
+    Simulated NOR flash for the host tests: an erase sets a sector to 0xFF, a
+    program can only clear bits (the new word is ANDed in). The memory is mapped
+    below 4GB so that its addresses fit the 32 bit addresses of the flash API.
+
+    A power loss is injected with flash_sim_power_loss(n): the next n program
+    operations complete, everything after them (program and erase) is lost until
+    flash_sim_power_on().
+*/
+
+#include <stdint.h>
+
+void flash_sim_init(const uint32_t first_sector, const uint32_t count, const uint32_t sector_size);
+void flash_sim_power_loss(const uint32_t programs);
+void flash_sim_power_on();
+
+uint32_t flash_sim_sector_address(const uint32_t sector);
+uint32_t flash_sim_sector_size(const uint32_t sector);
+uint32_t flash_sim_erase_sector(const uint32_t sector);
+uint32_t flash_sim_program_word(const uint32_t address, const uint32_t data);
+
+/* operation counters */
+extern uint32_t flash_sim_erases;
+extern uint32_t flash_sim_programs;
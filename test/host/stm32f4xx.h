@@ -0,0 +1,258 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/*
+    Host stand-in for the CMSIS device header: the peripherals used by the host
+    tests live in plain memory so that a test can preset and inspect the register
+    image. MODIFY_REG counts the read-modify-write cycles (register accesses on the
+    target).
+*/
+
+#include <stdint.h>
+
+#define __IO    volatile
+
+#define SET_BIT(REG, BIT)     ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)   ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)    ((REG) & (BIT))
+#define WRITE_REG(REG, VAL)   ((REG) = (VAL))
+#define READ_REG(REG)         ((REG))
+
+extern uint32_t host_register_rmw;
+
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+    do { host_register_rmw++; WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK))); } while (0)
+
+typedef struct {
+    __IO uint32_t MODER;
+    __IO uint32_t OTYPER;
+    __IO uint32_t OSPEEDR;
+    __IO uint32_t PUPDR;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+    __IO uint32_t LCKR;
+    __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct {
+    __IO uint32_t SR;
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t SMPR1;
+    __IO uint32_t SMPR2;
+    __IO uint32_t JOFR[4];
+    __IO uint32_t HTR;
+    __IO uint32_t LTR;
+    __IO uint32_t SQR1;
+    __IO uint32_t SQR2;
+    __IO uint32_t SQR3;
+    __IO uint32_t JSQR;
+    __IO uint32_t JDR[4];
+    __IO uint32_t DR;
+} ADC_TypeDef;
+
+typedef struct {
+    __IO uint32_t CSR;
+    __IO uint32_t CCR;
+    __IO uint32_t CDR;
+} ADC_Common_TypeDef;
+
+extern GPIO_TypeDef host_gpio[3];
+extern ADC_TypeDef host_adc1;
+extern ADC_Common_TypeDef host_adc_common;
+
+#define GPIOA   (&host_gpio[0])
+#define GPIOB   (&host_gpio[1])
+#define GPIOC   (&host_gpio[2])
+#define ADC1            (&host_adc1)
+#define ADC1_COMMON     (&host_adc_common)
+
+#define ADC_SR_OVR_Msk          (0x1U << 5)
+#define ADC_CR1_RES_Msk         (0x3U << 24)
+#define ADC_CR2_ADON_Msk        (0x1U << 0)
+#define ADC_CR2_ADON            ADC_CR2_ADON_Msk
+#define ADC_CR2_CONT_Msk        (0x1U << 1)
+#define ADC_CR2_CONT            ADC_CR2_CONT_Msk
+#define ADC_CR2_DMA_Msk         (0x1U << 8)
+#define ADC_CR2_DMA             ADC_CR2_DMA_Msk
+#define ADC_CR2_DDS_Msk         (0x1U << 9)
+#define ADC_CR2_DDS             ADC_CR2_DDS_Msk
+#define ADC_CR2_SWSTART_Msk     (0x1U << 30)
+#define ADC_CR2_SWSTART         ADC_CR2_SWSTART_Msk
+#define ADC_SMPR2_SMP0_Msk      (0x7U << 0)
+#define ADC_SQR1_L_Msk          (0xFU << 20)
+#define ADC_SQR3_SQ1_Pos        0
+#define ADC_SQR3_SQ1_Msk        (0x1FU << ADC_SQR3_SQ1_Pos)
+#define ADC_CCR_ADCPRE_Pos      16
+#define ADC_CCR_ADCPRE_Msk      (0x3U << ADC_CCR_ADCPRE_Pos)
+
+#define GPIO_MODER_MODER0_Msk      (0x3U << (0 * 2))
+#define GPIO_MODER_MODER0_0        (0x1U << (0 * 2))
+#define GPIO_OTYPER_OT0_Msk        (0x1U << 0)
+#define GPIO_OSPEEDR_OSPEED0_Msk   (0x3U << (0 * 2))
+#define GPIO_PUPDR_PUPD0_Msk       (0x3U << (0 * 2))
+#define GPIO_ODR_OD0               (0x1U << 0)
+#define GPIO_BSRR_BS0              (0x1U << 0)
+#define GPIO_BSRR_BR0              (0x1U << (0 + 16))
+
+#define GPIO_MODER_MODER1_Msk      (0x3U << (1 * 2))
+#define GPIO_MODER_MODER1_0        (0x1U << (1 * 2))
+#define GPIO_OTYPER_OT1_Msk        (0x1U << 1)
+#define GPIO_OSPEEDR_OSPEED1_Msk   (0x3U << (1 * 2))
+#define GPIO_PUPDR_PUPD1_Msk       (0x3U << (1 * 2))
+#define GPIO_ODR_OD1               (0x1U << 1)
+#define GPIO_BSRR_BS1              (0x1U << 1)
+#define GPIO_BSRR_BR1              (0x1U << (1 + 16))
+
+#define GPIO_MODER_MODER2_Msk      (0x3U << (2 * 2))
+#define GPIO_MODER_MODER2_0        (0x1U << (2 * 2))
+#define GPIO_OTYPER_OT2_Msk        (0x1U << 2)
+#define GPIO_OSPEEDR_OSPEED2_Msk   (0x3U << (2 * 2))
+#define GPIO_PUPDR_PUPD2_Msk       (0x3U << (2 * 2))
+#define GPIO_ODR_OD2               (0x1U << 2)
+#define GPIO_BSRR_BS2              (0x1U << 2)
+#define GPIO_BSRR_BR2              (0x1U << (2 + 16))
+
+#define GPIO_MODER_MODER3_Msk      (0x3U << (3 * 2))
+#define GPIO_MODER_MODER3_0        (0x1U << (3 * 2))
+#define GPIO_OTYPER_OT3_Msk        (0x1U << 3)
+#define GPIO_OSPEEDR_OSPEED3_Msk   (0x3U << (3 * 2))
+#define GPIO_PUPDR_PUPD3_Msk       (0x3U << (3 * 2))
+#define GPIO_ODR_OD3               (0x1U << 3)
+#define GPIO_BSRR_BS3              (0x1U << 3)
+#define GPIO_BSRR_BR3              (0x1U << (3 + 16))
+
+#define GPIO_MODER_MODER4_Msk      (0x3U << (4 * 2))
+#define GPIO_MODER_MODER4_0        (0x1U << (4 * 2))
+#define GPIO_OTYPER_OT4_Msk        (0x1U << 4)
+#define GPIO_OSPEEDR_OSPEED4_Msk   (0x3U << (4 * 2))
+#define GPIO_PUPDR_PUPD4_Msk       (0x3U << (4 * 2))
+#define GPIO_ODR_OD4               (0x1U << 4)
+#define GPIO_BSRR_BS4              (0x1U << 4)
+#define GPIO_BSRR_BR4              (0x1U << (4 + 16))
+
+#define GPIO_MODER_MODER5_Msk      (0x3U << (5 * 2))
+#define GPIO_MODER_MODER5_0        (0x1U << (5 * 2))
+#define GPIO_OTYPER_OT5_Msk        (0x1U << 5)
+#define GPIO_OSPEEDR_OSPEED5_Msk   (0x3U << (5 * 2))
+#define GPIO_PUPDR_PUPD5_Msk       (0x3U << (5 * 2))
+#define GPIO_ODR_OD5               (0x1U << 5)
+#define GPIO_BSRR_BS5              (0x1U << 5)
+#define GPIO_BSRR_BR5              (0x1U << (5 + 16))
+
+#define GPIO_MODER_MODER6_Msk      (0x3U << (6 * 2))
+#define GPIO_MODER_MODER6_0        (0x1U << (6 * 2))
+#define GPIO_OTYPER_OT6_Msk        (0x1U << 6)
+#define GPIO_OSPEEDR_OSPEED6_Msk   (0x3U << (6 * 2))
+#define GPIO_PUPDR_PUPD6_Msk       (0x3U << (6 * 2))
+#define GPIO_ODR_OD6               (0x1U << 6)
+#define GPIO_BSRR_BS6              (0x1U << 6)
+#define GPIO_BSRR_BR6              (0x1U << (6 + 16))
+
+#define GPIO_MODER_MODER7_Msk      (0x3U << (7 * 2))
+#define GPIO_MODER_MODER7_0        (0x1U << (7 * 2))
+#define GPIO_OTYPER_OT7_Msk        (0x1U << 7)
+#define GPIO_OSPEEDR_OSPEED7_Msk   (0x3U << (7 * 2))
+#define GPIO_PUPDR_PUPD7_Msk       (0x3U << (7 * 2))
+#define GPIO_ODR_OD7               (0x1U << 7)
+#define GPIO_BSRR_BS7              (0x1U << 7)
+#define GPIO_BSRR_BR7              (0x1U << (7 + 16))
+
+#define GPIO_MODER_MODER8_Msk      (0x3U << (8 * 2))
+#define GPIO_MODER_MODER8_0        (0x1U << (8 * 2))
+#define GPIO_OTYPER_OT8_Msk        (0x1U << 8)
+#define GPIO_OSPEEDR_OSPEED8_Msk   (0x3U << (8 * 2))
+#define GPIO_PUPDR_PUPD8_Msk       (0x3U << (8 * 2))
+#define GPIO_ODR_OD8               (0x1U << 8)
+#define GPIO_BSRR_BS8              (0x1U << 8)
+#define GPIO_BSRR_BR8              (0x1U << (8 + 16))
+
+#define GPIO_MODER_MODER9_Msk      (0x3U << (9 * 2))
+#define GPIO_MODER_MODER9_0        (0x1U << (9 * 2))
+#define GPIO_OTYPER_OT9_Msk        (0x1U << 9)
+#define GPIO_OSPEEDR_OSPEED9_Msk   (0x3U << (9 * 2))
+#define GPIO_PUPDR_PUPD9_Msk       (0x3U << (9 * 2))
+#define GPIO_ODR_OD9               (0x1U << 9)
+#define GPIO_BSRR_BS9              (0x1U << 9)
+#define GPIO_BSRR_BR9              (0x1U << (9 + 16))
+
+#define GPIO_MODER_MODER10_Msk      (0x3U << (10 * 2))
+#define GPIO_MODER_MODER10_0        (0x1U << (10 * 2))
+#define GPIO_OTYPER_OT10_Msk        (0x1U << 10)
+#define GPIO_OSPEEDR_OSPEED10_Msk   (0x3U << (10 * 2))
+#define GPIO_PUPDR_PUPD10_Msk       (0x3U << (10 * 2))
+#define GPIO_ODR_OD10               (0x1U << 10)
+#define GPIO_BSRR_BS10              (0x1U << 10)
+#define GPIO_BSRR_BR10              (0x1U << (10 + 16))
+
+#define GPIO_MODER_MODER11_Msk      (0x3U << (11 * 2))
+#define GPIO_MODER_MODER11_0        (0x1U << (11 * 2))
+#define GPIO_OTYPER_OT11_Msk        (0x1U << 11)
+#define GPIO_OSPEEDR_OSPEED11_Msk   (0x3U << (11 * 2))
+#define GPIO_PUPDR_PUPD11_Msk       (0x3U << (11 * 2))
+#define GPIO_ODR_OD11               (0x1U << 11)
+#define GPIO_BSRR_BS11              (0x1U << 11)
+#define GPIO_BSRR_BR11              (0x1U << (11 + 16))
+
+#define GPIO_MODER_MODER12_Msk      (0x3U << (12 * 2))
+#define GPIO_MODER_MODER12_0        (0x1U << (12 * 2))
+#define GPIO_OTYPER_OT12_Msk        (0x1U << 12)
+#define GPIO_OSPEEDR_OSPEED12_Msk   (0x3U << (12 * 2))
+#define GPIO_PUPDR_PUPD12_Msk       (0x3U << (12 * 2))
+#define GPIO_ODR_OD12               (0x1U << 12)
+#define GPIO_BSRR_BS12              (0x1U << 12)
+#define GPIO_BSRR_BR12              (0x1U << (12 + 16))
+
+#define GPIO_MODER_MODER13_Msk      (0x3U << (13 * 2))
+#define GPIO_MODER_MODER13_0        (0x1U << (13 * 2))
+#define GPIO_OTYPER_OT13_Msk        (0x1U << 13)
+#define GPIO_OSPEEDR_OSPEED13_Msk   (0x3U << (13 * 2))
+#define GPIO_PUPDR_PUPD13_Msk       (0x3U << (13 * 2))
+#define GPIO_ODR_OD13               (0x1U << 13)
+#define GPIO_BSRR_BS13              (0x1U << 13)
+#define GPIO_BSRR_BR13              (0x1U << (13 + 16))
+
+#define GPIO_MODER_MODER14_Msk      (0x3U << (14 * 2))
+#define GPIO_MODER_MODER14_0        (0x1U << (14 * 2))
+#define GPIO_OTYPER_OT14_Msk        (0x1U << 14)
+#define GPIO_OSPEEDR_OSPEED14_Msk   (0x3U << (14 * 2))
+#define GPIO_PUPDR_PUPD14_Msk       (0x3U << (14 * 2))
+#define GPIO_ODR_OD14               (0x1U << 14)
+#define GPIO_BSRR_BS14              (0x1U << 14)
+#define GPIO_BSRR_BR14              (0x1U << (14 + 16))
+
+#define GPIO_MODER_MODER15_Msk      (0x3U << (15 * 2))
+#define GPIO_MODER_MODER15_0        (0x1U << (15 * 2))
+#define GPIO_OTYPER_OT15_Msk        (0x1U << 15)
+#define GPIO_OSPEEDR_OSPEED15_Msk   (0x3U << (15 * 2))
+#define GPIO_PUPDR_PUPD15_Msk       (0x3U << (15 * 2))
+#define GPIO_ODR_OD15               (0x1U << 15)
+#define GPIO_BSRR_BS15              (0x1U << 15)
+#define GPIO_BSRR_BR15              (0x1U << (15 + 16))
@@ -0,0 +1,146 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include "test.h"
+#include "lcdview.h"
+
+/*
+    Host test of the display cells: the bar resolves one pixel column over the whole
+    row and saturates at full scale, the trend spans the 8 levels (glyphs 1..7 and
+    the ROM block) between the smallest and the largest value.
+*/
+
+#define BAR_CELLS       16
+
+/* pixel columns drawn by a bar (full cells and the partial glyph) */
+static uint32_t bar_pixels(const char *cells, const uint32_t used, const uint8_t *glyph)
+{
+    uint32_t pixels = 0;
+
+    for (uint32_t i = 0; i < BAR_CELLS; i++) {
+        if (cells[i] == LCDVIEW_CHAR_FULL) {
+            pixels += LCDVIEW_CELL_COLUMNS;
+        } else if (cells[i] == LCDVIEW_CHAR(LCDVIEW_GLYPH_BAR)) {
+            CHECK(used);
+            pixels += (uint32_t)__builtin_popcount(glyph[0]);
+        } else {
+            CHECK_EQ(cells[i], ' ');
+        }
+    }
+    return pixels;
+}
+
+static void test_bar()
+{
+    char cells[BAR_CELLS];
+    uint8_t glyph[LCDVIEW_CELL_ROWS];
+
+    /* empty and full */
+    CHECK_EQ(lcdview_bar(cells, BAR_CELLS, 0, 1000, glyph), 0);
+    CHECK_EQ(bar_pixels(cells, 0, glyph), 0);
+    CHECK_EQ(lcdview_bar(cells, BAR_CELLS, 1000, 1000, glyph), 0);
+    CHECK_EQ(bar_pixels(cells, 0, glyph), BAR_CELLS * LCDVIEW_CELL_COLUMNS);
+
+    /* above the full scale: saturated */
+    CHECK_EQ(lcdview_bar(cells, BAR_CELLS, 5000, 1000, glyph), 0);
+    CHECK_EQ(bar_pixels(cells, 0, glyph), BAR_CELLS * LCDVIEW_CELL_COLUMNS);
+
+    /* 3 pixels: the three leftmost columns of the first cell on every row */
+    CHECK_EQ(lcdview_bar(cells, BAR_CELLS, 3, BAR_CELLS * LCDVIEW_CELL_COLUMNS, glyph), 1);
+    CHECK_EQ(cells[0], LCDVIEW_CHAR(LCDVIEW_GLYPH_BAR));
+    for (uint32_t i = 0; i < LCDVIEW_CELL_ROWS; i++) {
+        CHECK_EQ(glyph[i], 0x1C);
+    }
+
+    /* every pixel column of the row, a string without a 0 */
+    for (uint32_t pixels = 0; pixels <= BAR_CELLS * LCDVIEW_CELL_COLUMNS; pixels++) {
+        uint32_t used = lcdview_bar(cells, BAR_CELLS, pixels * 41, BAR_CELLS * LCDVIEW_CELL_COLUMNS * 41, glyph);
+        CHECK_EQ(used, (pixels % LCDVIEW_CELL_COLUMNS) != 0);
+        CHECK_EQ(bar_pixels(cells, used, glyph), pixels);
+        CHECK(memchr(cells, 0, BAR_CELLS) == NULL);
+    }
+}
+
+/* level of a trend cell: 1..7 - glyph, 8 - ROM block */
+static uint32_t trend_level(const char c)
+{
+    if (c == LCDVIEW_CHAR_FULL) {
+        return LCDVIEW_TREND_LEVELS;
+    }
+    CHECK((c >= LCDVIEW_CHAR(LCDVIEW_GLYPH_TREND)) && (c < LCDVIEW_CHAR(LCDVIEW_GLYPHS)));
+    return (uint32_t)(c - LCDVIEW_CHAR(LCDVIEW_GLYPH_TREND)) + 1;
+}
+
+static void test_trend()
+{
+    char cells[LCDVIEW_TREND_LEVELS];
+
+    /* a ramp over the 8 levels: one level per value, the top one is the ROM block */
+    const uint32_t ramp[LCDVIEW_TREND_LEVELS] = { 1000, 1100, 1200, 1300, 1400, 1500, 1600, 1700 };
+    lcdview_trend(cells, ramp, LCDVIEW_TREND_LEVELS);
+    for (uint32_t i = 0; i < LCDVIEW_TREND_LEVELS; i++) {
+        CHECK_EQ(trend_level(cells[i]), i + 1);
+    }
+    CHECK_EQ(cells[LCDVIEW_TREND_LEVELS - 1], LCDVIEW_CHAR_FULL);
+
+    /* the smallest value is level 1, the largest level 8, whatever the offset */
+    const uint32_t step[4] = { 3300000, 3300000, 3300001, 3300001 };
+    lcdview_trend(cells, step, 4);
+    CHECK_EQ(trend_level(cells[0]), 1);
+    CHECK_EQ(trend_level(cells[1]), 1);
+    CHECK_EQ(trend_level(cells[2]), LCDVIEW_TREND_LEVELS);
+    CHECK_EQ(trend_level(cells[3]), LCDVIEW_TREND_LEVELS);
+
+    /* flat: half height */
+    const uint32_t flat[3] = { 1656000, 1656000, 1656000 };
+    lcdview_trend(cells, flat, 3);
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK_EQ(trend_level(cells[i]), LCDVIEW_TREND_LEVELS / 2);
+    }
+
+    /* one value (first block after the start) */
+    lcdview_trend(cells, flat, 1);
+    CHECK_EQ(trend_level(cells[0]), LCDVIEW_TREND_LEVELS / 2);
+}
+
+/* glyph n of the trend has the lowest n rows on */
+static void test_trend_glyphs()
+{
+    for (uint32_t level = 1; level < LCDVIEW_TREND_LEVELS; level++) {
+        for (uint32_t row = 0; row < LCDVIEW_CELL_ROWS; row++) {
+            CHECK_EQ(lcdview_trend_glyphs[level - 1][row], (row >= (LCDVIEW_CELL_ROWS - level)) ? 0x1F : 0x00);
+        }
+    }
+}
+
+int main()
+{
+    TEST_RUN(test_bar);
+    TEST_RUN(test_trend);
+    TEST_RUN(test_trend_glyphs);
+    return test_result("lcdview_test");
+}
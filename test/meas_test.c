@@ -0,0 +1,175 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#include <math.h>
+#include "test.h"
+#include "acq.h"
+#include "meas.h"
+
+/*
+    Golden trace test of the block reduction and conversion of vTaskDma: synthetic
+    ADC traces (DC, noise, sine, steps, saturation) are packed like the DMA stores
+    them and run through meas_sum_packed and meas_microvolts with the scale of the
+    default configuration. The golden sums and voltages were computed independently
+    (exact integer sum, floored Q24 product); the voltage is also checked against
+    the exact value within 1uV.
+*/
+
+#define TRACE_LENGTH    ACQ_BLOCK_SIZE
+
+typedef struct golden_t {
+    const char *name;
+    void (*generate)(uint16_t *samples, const uint32_t length);
+    uint32_t sum;
+    uint32_t microvolts;
+} golden_t;
+
+static void trace_dc(uint16_t *samples, const uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        samples[i] = 2048;
+    }
+}
+
+/* uniform 12 bit noise (LCG, fixed seed) */
+static void trace_noise(uint16_t *samples, const uint32_t length)
+{
+    uint32_t x = 12345;
+
+    for (uint32_t i = 0; i < length; i++) {
+        x = (x * 1664525) + 1013904223;
+        samples[i] = x >> 20;
+    }
+}
+
+/* 10 periods of a 2000 LSB sine around mid scale */
+static void trace_sine(uint16_t *samples, const uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        samples[i] = (uint16_t)lround(2048 + (2000 * sin((2 * M_PI * i) / 100)));
+    }
+}
+
+/* four levels, the last one at full scale */
+static void trace_steps(uint16_t *samples, const uint32_t length)
+{
+    static const uint16_t levels[4] = { 0, 1024, 3072, 4095 };
+
+    for (uint32_t i = 0; i < length; i++) {
+        samples[i] = levels[(i * 4) / length];
+    }
+}
+
+static void trace_saturation(uint16_t *samples, const uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        samples[i] = ACQ_FULL_SCALE - 1;
+    }
+}
+
+static const golden_t golden[] = {
+    { "dc",         trace_dc,         2048000, 1656000 },
+    { "noise",      trace_noise,      2077245, 1679647 },
+    { "sine",       trace_sine,       2048000, 1656000 },
+    { "steps",      trace_steps,      2047750, 1655797 },
+    { "saturation", trace_saturation, 4095000, 3311191 },
+};
+
+/* DMA layout: sample 2n in the low, 2n+1 in the high half word */
+static void pack(const uint16_t *samples, const uint32_t length, uint32_t *buffer)
+{
+    for (uint32_t i = 0; i < length / 2; i++) {
+        buffer[i] = samples[2 * i] | ((uint32_t)samples[(2 * i) + 1] << 16);
+    }
+}
+
+static void test_scale()
+{
+    acq_derived_t derived;
+
+    /* 3.312V / (4096 * 1000) in Q24 */
+    acq_derive(&acq_default_config, 1, &derived);
+    CHECK_EQ(derived.scale_q24, 13565952);
+    CHECK_EQ(derived.scale_q24, acq_default_derived.scale_q24);
+}
+
+static void test_golden()
+{
+    static uint16_t samples[TRACE_LENGTH];
+    static uint32_t buffer[TRACE_LENGTH / 2];
+    acq_derived_t derived;
+
+    acq_derive(&acq_default_config, 1, &derived);
+    for (uint32_t t = 0; t < sizeof(golden) / sizeof(golden[0]); t++) {
+        golden[t].generate(samples, TRACE_LENGTH);
+        pack(samples, TRACE_LENGTH, buffer);
+
+        uint32_t sum = meas_sum_packed(buffer, TRACE_LENGTH);
+        uint32_t uv = meas_microvolts(sum, derived.scale_q24);
+        double exact = ((double)sum * ACQ_VREF_UV) / ((double)ACQ_FULL_SCALE * TRACE_LENGTH);
+
+        if ((sum != golden[t].sum) || (uv != golden[t].microvolts)) {
+            printf("    %s: sum %u uV %u\n", golden[t].name, sum, uv);
+        }
+        CHECK_EQ(sum, golden[t].sum);
+        CHECK_EQ(uv, golden[t].microvolts);
+        CHECK(fabs(uv - exact) < 1.0);
+    }
+}
+
+/* the halves of a word are separate samples (no carry between them) */
+static void test_packing()
+{
+    uint32_t buffer[4] = { 0x0FFF0000, 0x00000FFF, 0x0FFF0FFF, 0x00010002 };
+
+    CHECK_EQ(meas_sum_packed(buffer, 8), (4 * 4095) + 3);
+    CHECK_EQ(meas_sum_packed(buffer, 2), 4095);
+    CHECK_EQ(meas_sum_packed(buffer, 0), 0);
+}
+
+/* the largest block of the pool at full scale: no overflow of the sum or of the voltage */
+static void test_largest_block()
+{
+    static uint32_t buffer[ACQ_POOL_SAMPLES / 4];
+    const uint32_t length = ACQ_POOL_SAMPLES / 2;
+
+    for (uint32_t i = 0; i < length / 2; i++) {
+        buffer[i] = 0x0FFF0FFF;
+    }
+    uint32_t sum = meas_sum_packed(buffer, length);
+    CHECK_EQ(sum, 4095 * length);
+    CHECK_EQ(meas_microvolts(sum, ACQ_SCALE_Q24(length)), (uint32_t)(((uint64_t)4095 * ACQ_VREF_UV) / ACQ_FULL_SCALE));
+}
+
+int main()
+{
+    TEST_RUN(test_scale);
+    TEST_RUN(test_golden);
+    TEST_RUN(test_packing);
+    TEST_RUN(test_largest_block);
+    return test_result("meas_test");
+}
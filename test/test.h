@@ -0,0 +1,70 @@
+/*_____________________________________________________________________________
+ │                                                                            |
+ │ COPYRIGHT (C) 2021 Mihai Baneu                                             |
+ │                                                                            |
+ | Permission is hereby  granted,  free of charge,  to any person obtaining a |
+ | copy of this software and associated documentation files (the "Software"), |
+ | to deal in the Software without restriction,  including without limitation |
+ | the rights to  use, copy, modify, merge, publish, distribute,  sublicense, |
+ | and/or sell copies  of  the Software, and to permit  persons to  whom  the |
+ | Software is furnished to do so, subject to the following conditions:       |
+ |                                                                            |
+ | The above  copyright notice  and this permission notice  shall be included |
+ | in all copies or substantial portions of the Software.                     |
+ |                                                                            |
+ | THE SOFTWARE IS PROVIDED  "AS IS",  WITHOUT WARRANTY OF ANY KIND,  EXPRESS |
+ | OR   IMPLIED,   INCLUDING   BUT   NOT   LIMITED   TO   THE  WARRANTIES  OF |
+ | MERCHANTABILITY,  FITNESS FOR  A  PARTICULAR  PURPOSE AND NONINFRINGEMENT. |
+ | IN NO  EVENT SHALL  THE AUTHORS  OR  COPYRIGHT  HOLDERS  BE LIABLE FOR ANY |
+ | CLAIM, DAMAGES OR OTHER LIABILITY,  WHETHER IN AN ACTION OF CONTRACT, TORT |
+ | OR OTHERWISE, ARISING FROM,  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR  |
+ | THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                 |
+ |____________________________________________________________________________|
+ |                                                                            |
+ |  Author: Mihai Baneu                           Last modified: 20.Mai.2021  |
+ |                                                                            |
+ |___________________________________________________________________________*/
+
+#pragma once
+
+/*
+    Minimal check macros for the host tests (make test). Every test is a separate
+    program that returns a non zero exit code if a check failed.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);             \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                  \
+    do {                                                                                \
+        long long _a = (long long)(a), _b = (long long)(b);                             \
+        if (_a != _b) {                                                                 \
+            printf("%s:%d: %s == %s failed (%lld != %lld)\n",                            \
+                   __FILE__, __LINE__, #a, #b, _a, _b);                                 \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+#define TEST_RUN(fn)                                                                    \
+    do {                                                                                \
+        int _failures = test_failures;                                                  \
+        fn();                                                                           \
+        printf("  %-40s %s\n", #fn, (test_failures == _failures) ? "ok" : "FAILED");   \
+    } while (0)
+
+static inline int test_result(const char *name)
+{
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "passed");
+    return test_failures ? 1 : 0;
+}